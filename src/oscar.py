@@ -142,6 +142,8 @@ class EngineBoundType(type):
     object that needs it.
     """
     _active_engine = None
+    # Bumped by scene recalls, which replace the engine's objects.
+    _generation = 0
 
     def bind_engine(cls, engine_instance:oscar_server.AudioEngine) -> None:
         """Binds a single engine instance to this class."""
@@ -153,6 +155,29 @@ class EngineBoundType(type):
             raise RuntimeError(f"{cls.__name__} is not bound to an engine.")
         return cls._active_engine
 
+class EnginePtr:
+    """The wrapped engine object, looked up again by name once a scene recall has replaced it.
+
+    A recall keeps the names but swaps in new engine objects, so wrappers the
+    user is holding keep working on whatever now plays under their name.
+    """
+    def __init__(self, find:str, name:str):
+        self.find = find
+        self.name = name
+
+    def __get__(self, obj, owner=None):
+        if obj is None:
+            return self
+        ptr, generation = obj.__dict__['_ptr']
+        if generation != EngineBoundType._generation:
+            found = getattr(obj.engine, self.find)(getattr(obj, self.name))
+            ptr = found if found is not None else ptr
+            obj.__dict__['_ptr'] = (ptr, EngineBoundType._generation)
+        return ptr
+
+    def __set__(self, obj, ptr) -> None:
+        obj.__dict__['_ptr'] = (ptr, EngineBoundType._generation)
+
 class Synth(metaclass=EngineBoundType):
     """A Python wrapper for the C++ Synth class.
 
@@ -165,6 +190,9 @@ class Synth(metaclass=EngineBoundType):
         'saw': lambda table_size: np.linspace(-1, 1, table_size, endpoint=False).astype(np.float32),
         'triangle': lambda table_size: 1-2*np.abs(np.linspace(-1, 1, table_size, endpoint=False)).astype(np.float32)
     }
+    # The engine builds these itself, so regenerating them skips NumPy and the GIL.
+    NATIVE_WAVES = {fn: name for name, fn in WAVES.items()}
+    ptr = EnginePtr('find_synth', 'synth_name')
 
     def __init__(self, name:str, frequency:float = 440.0, amplitude:float = 0.5, offset:float = 0.0, wave_fn:Callable = WAVES['sine'], fn_args:dict = {}):
         self.engine = self.__class__.get_engine()
@@ -172,16 +200,34 @@ class Synth(metaclass=EngineBoundType):
         self.wave_fn = wave_fn
         self.fn_args = fn_args
         self.table_size = 2048
+        self.crossfade = 0
         self.wavetable = None
         self.regen(update=False)
-        self.ptr = self.engine.get_or_create_synth(self.synth_name, self.wavetable)
+        self.ptr = self._create()
         self.freq(frequency)
         self.amp(amplitude)
         self.phase(offset)
         self.start()
     
+    def _create(self):
+        return self.engine.get_or_create_synth(self.synth_name, self.wavetable)
+
+    def _nativeShape(self):
+        name = self.wave_fn if isinstance(self.wave_fn, str) else Synth.NATIVE_WAVES.get(self.wave_fn)
+        if name is None or self.fn_args:
+            return None
+        return oscar_server.WaveShape.__members__[name]
+
     def regen(self, rebuild:bool = True, update:bool = True, norm:bool = True) -> None:
         """Rebuilds the wavetable and optionally updates the engine."""
+        shape = self._nativeShape()
+        if rebuild and shape is not None:
+            # Built-in shapes are generated by the engine, already normalized.
+            if update:
+                self.ptr.generate_wave(shape, self.table_size, self.crossfade)
+            else:
+                self.wavetable = oscar_server.wave_table(shape, self.table_size)
+            return
         if rebuild:
             wavetable = self.wave_fn(self.table_size, **self.fn_args)
             # Normalize the table to be between -1.0 and 1.0
@@ -189,7 +235,7 @@ class Synth(metaclass=EngineBoundType):
                 wavetable /= np.max(np.abs(wavetable))
         self.wavetable = wavetable
         if update:
-            self.ptr.update_wavetable(self.wavetable)
+            self.ptr.update_wavetable(self.wavetable, self.crossfade)
 
     def name(self) -> str:
         """Returns the name of the synth."""
@@ -231,21 +277,164 @@ class Synth(metaclass=EngineBoundType):
         else:
             self.ptr.set_amplitude(amp)
 
+    def mode(self, mode:str = None) -> None | str:
+        """Gets or sets the phase mode: 'absolute' (locked to the master clock) or 'accumulator' (continuous)."""
+        if mode == None:
+            return self.ptr.get_phase_mode().name
+        else:
+            self.ptr.set_phase_mode(oscar_server.PhaseMode.__members__[mode])
+
+    def resync(self, seconds:float = None) -> None | float:
+        """Gets or sets how often an 'accumulator' synth is pulled back onto the master clock (0 = never)."""
+        if seconds == None:
+            return self.ptr.get_resync_interval()
+        else:
+            self.ptr.set_resync_interval(seconds)
+
+    def fade(self, samples:int|None = None) -> None | int:
+        """Gets or sets how many samples a new wavetable is crossfaded in over (0 switches instantly)."""
+        if samples == None:
+            return self.crossfade
+        else:
+            self.crossfade = max(0, int(samples))
+
+    def glide(self, param:str, target:float, seconds:float, shape:str = 'linear', at:int|None = None) -> None:
+        """Glides 'freq', 'amp', 'phase' or 'position' to target over `seconds`, interpolated per sample by the engine.
+
+        shape is 'linear' or 'exponential' (phase and position glides are always linear); at is an optional start sample time.
+        """
+        samples = max(0, int(round(seconds * self.engine.get_sample_rate())))
+        start = 0 if at == None else at
+        ramp_shape = oscar_server.RampShape.__members__[shape]
+        if param == 'freq':
+            self.ptr.ramp_frequency(target, samples, ramp_shape, start)
+        elif param == 'amp':
+            self.ptr.ramp_amplitude(target, samples, ramp_shape, start)
+        elif param == 'phase':
+            self.ptr.ramp_phase_offset(target, samples, start)
+        elif param == 'position':
+            self.ptr.ramp_position(target, samples, start)
+        else:
+            raise ValueError(f"Cannot glide '{param}': expected 'freq', 'amp', 'phase' or 'position'.")
+
+    def mod(self, param:str, source:'str|Synth', depth:float) -> None:
+        """Adds depth times another synth's output to 'freq' (Hz), 'amp' or 'phase' (cycles) at audio rate; depth 0 removes it."""
+        source_name = source.name() if isinstance(source, Synth) else source
+        target = {'freq': 'frequency', 'amp': 'amplitude', 'phase': 'phase_offset'}[param]
+        self.engine.modulate(source_name, self.synth_name, oscar_server.ModParam.__members__[target], depth)
+
+    def bandlimit(self, enabled:bool|None = None) -> None | bool:
+        """Gets or sets whether the synth plays band-limited copies of its table to avoid aliasing."""
+        if enabled == None:
+            return self.ptr.get_band_limited()
+        else:
+            self.ptr.set_band_limited(enabled)
+
+    def interp(self, mode:str|None = None, table_size:int|None = None) -> None | str:
+        """Gets or sets how the table is read between entries ('none', 'linear', 'hermite' or 'sinc'), optionally rebuilding it at table_size."""
+        if mode == None:
+            return self.ptr.get_interpolation().name
+        self.ptr.set_interpolation(oscar_server.Interpolation.__members__[mode])
+        if table_size is not None and table_size != self.table_size:
+            self.table_size = table_size
+            self.regen()
+
     def wave(self, wave_fn:callable = None, fn_args:dict = {}, norm:bool = True) -> None | Callable:
-        """Gets or sets the wavetable function for the synth."""
+        """Gets or sets the wavetable function for the synth, or a built-in shape by name ('sine', 'saw', 'square', 'triangle')."""
         if wave_fn == None:
             return self.wave_fn
         else:
             self.wave_fn = wave_fn
             self.regen(norm=norm)
+
+    def frames(self, tables:list, norm:bool = True) -> None:
+        """Installs a wavetable set: a list of tables or wave functions, played one at a time by position()."""
+        stack = []
+        for table in tables:
+            t = np.asarray(table(self.table_size) if callable(table) else table, dtype=np.float32)
+            if len(t) != self.table_size:
+                t = np.interp(np.arange(self.table_size) * len(t) / self.table_size, np.arange(len(t) + 1), np.append(t, t[0])).astype(np.float32)
+            if norm and np.max(np.abs(t)) > 0:
+                t = t / np.max(np.abs(t))
+            stack.append(t)
+        self.ptr.update_wavetable(np.stack(stack), self.crossfade)
+
+    def position(self, p:float|None = None) -> None | float:
+        """Gets or sets the frame of the wavetable set being played; 1.5 is halfway between the second and third."""
+        if p == None:
+            return self.ptr.get_position()
+        else:
+            self.ptr.set_position(p)
+
+    def partials(self, amps:list[float], phases:list[float] = [], norm:bool = True) -> None:
+        """Installs a sum of harmonics 1, 2, 3... at the given amplitudes and phases (in cycles), built in the engine."""
+        self.ptr.generate_partials(amps, phases, self.table_size, norm, self.crossfade)
+
+    def path(self, points, axis:int, closed:bool = True) -> None:
+        """Installs the X (axis 0) or Y (axis 1) coordinate of a polyline of (x, y) points, traced at constant speed."""
+        self.ptr.generate_path(np.asarray(points, dtype=np.float32).reshape(-1, 2), axis, closed, self.table_size, self.crossfade)
+
+    def morph(self, a, b, t:float, norm:bool = True) -> None:
+        """Installs a blend of tables a and b (t = 0 is a, 1 is b), computed in the engine."""
+        self.ptr.morph_wavetables(a, b, t, self.table_size, norm, self.crossfade)
     
+class LFO(Synth):
+    """A synth meant as a modulation source: full amplitude, slow, and not patched to any output."""
+    def __init__(self, name:str, rate:float = 1.0, wave_fn:Callable = Synth.WAVES['sine'], fn_args:dict = {}):
+        super().__init__(name, frequency=rate, amplitude=1.0, wave_fn=wave_fn, fn_args=fn_args)
+
+class PolySynth(Synth):
+    """A synth with a fixed pool of voices, played with MIDI note numbers.
+
+    The voices and their envelopes live in the engine, so notes are queued
+    like any other parameter change and land within one buffer. freq() sets
+    the tuning of A4 (note 69).
+    """
+    def __init__(self, name:str, voices:int = 8, amplitude:float = 0.5, wave_fn:Callable = Synth.WAVES['sine'], fn_args:dict = {}):
+        self.polyphony = voices
+        super().__init__(name, frequency=440.0, amplitude=amplitude, wave_fn=wave_fn, fn_args=fn_args)
+
+    def _create(self):
+        return self.engine.get_or_create_poly_synth(self.synth_name, self.wavetable, self.polyphony)
+
+    def noteOn(self, note:float, velocity:float = 1.0, at:int|None = None) -> None:
+        """Starts a note (MIDI note number) at velocity 0 to 1; at is an optional sample time."""
+        self.ptr.note_on(note, velocity, 0 if at == None else at)
+
+    def noteOff(self, note:float, at:int|None = None) -> None:
+        """Releases a note."""
+        self.ptr.note_off(note, 0 if at == None else at)
+
+    def allOff(self) -> None:
+        """Releases every note."""
+        self.ptr.all_notes_off()
+
+    def envelope(self, attack:float|None = None, decay:float = 0.1, sustain:float = 0.8, release:float = 0.2) -> None | tuple:
+        """Gets or sets the ADSR envelope: times in seconds, sustain level 0 to 1."""
+        if attack == None:
+            return self.ptr.get_envelope()
+        self.ptr.set_envelope(attack, decay, sustain, release)
+
+    def voices(self) -> int:
+        """Returns how many voices are sounding."""
+        return self.ptr.get_active_voices()
+
+    def midi(self, message) -> None:
+        """Plays a mido note_on/note_off message; pass this as a MidiInput callback."""
+        if message.type == 'note_on' and message.velocity > 0:
+            self.noteOn(message.note, message.velocity / 127.0)
+        elif message.type in ('note_on', 'note_off'):
+            self.noteOff(message.note)
+
 class Patch(metaclass=EngineBoundType):
     """A Python wrapper for the C++ Patch class.
 
     This class provides a more Pythonic interface to the underlying C++ patch
     object.
     """
-    def __init__(self, patch_name:str, synth:str|Synth, channels:list[int]):
+    ptr = EnginePtr('find_patch', 'patch_name')
+
+    def __init__(self, patch_name:str, synth:str|Synth, channels:list[int], bus:'str|Bus|None' = None):
         self.engine = self.__class__.get_engine()
         self.patch_name = patch_name
         if isinstance(synth, str):
@@ -253,7 +442,7 @@ class Patch(metaclass=EngineBoundType):
         else:
             synth_name = synth.name()
         self.synth_name = synth_name
-        self.ptr = self.engine.get_or_create_patch(self.patch_name, self.synth_name, channels)
+        self.ptr = self.engine.get_or_create_patch(self.patch_name, self.synth_name, channels, Bus._busName(bus))
 
     def get_synth_name(self) -> str:
         """Returns the name of the synth being patched."""
@@ -279,6 +468,93 @@ class Patch(metaclass=EngineBoundType):
         else:
             self.ptr.set_channels(c)
 
+    def bus(self, b:'str|Bus|None' = None) -> None | str:
+        """Gets the bus being patched into, or routes the patch into bus b (lanes 0 = X, 1 = Y); '' goes back to device channels."""
+        if b == None:
+            return self.ptr.get_bus_name()
+        self.ptr.set_bus(Bus._busName(b))
+
+class Bus(metaclass=EngineBoundType):
+    """An X/Y sub-mix that patches route into, with its own gain and transform.
+
+    Moving, rotating or fading a whole figure is one update to its bus instead
+    of one per synth. The bus output is gain * rotate * scale * (x, y) + offset.
+    """
+    ptr = EnginePtr('find_bus', 'bus_name')
+
+    def __init__(self, name:str, ch:list[int] = [0, 1], parent:'str|Bus|None' = None):
+        self.engine = self.__class__.get_engine()
+        self.bus_name = name
+        self.angle = 0.0
+        self.sx = 1.0
+        self.sy = 1.0
+        self.ptr = self.engine.get_or_create_bus(name, ch, Bus._busName(parent))
+
+    @staticmethod
+    def _busName(b) -> str:
+        if b is None:
+            return ''
+        return b if isinstance(b, str) else b.name()
+
+    def name(self) -> str:
+        """Returns the name of the bus."""
+        return self.bus_name
+
+    def gain(self, g:float|None = None) -> None | float:
+        """Gets or sets the gain of the bus."""
+        if g == None:
+            return self.ptr.get_gain()
+        self.ptr.set_gain(g)
+
+    def _updateMatrix(self) -> None:
+        c, s = np.cos(2 * np.pi * self.angle), np.sin(2 * np.pi * self.angle)
+        self.ptr.set_matrix(c * self.sx, -s * self.sy, s * self.sx, c * self.sy)
+
+    def rotate(self, turns:float|None = None) -> None | float:
+        """Gets or sets the rotation of the figure, in turns (0.25 is a quarter turn anticlockwise)."""
+        if turns == None:
+            return self.angle
+        self.angle = turns
+        self._updateMatrix()
+
+    def scale(self, sx:float|None = None, sy:float|None = None) -> None | tuple:
+        """Gets or sets the X and Y scale of the figure (sy defaults to sx)."""
+        if sx == None:
+            return (self.sx, self.sy)
+        self.sx = sx
+        self.sy = sx if sy == None else sy
+        self._updateMatrix()
+
+    def move(self, x:float|None = None, y:float = 0.0) -> None | tuple:
+        """Gets or sets the offset the figure is moved by."""
+        if x == None:
+            return self.ptr.get_translate()
+        self.ptr.set_translate(x, y)
+
+    def matrix(self, a:float|None = None, b:float = 0.0, c:float = 0.0, d:float = 1.0) -> None | tuple:
+        """Gets or sets the raw 2x2 matrix (x' = a*x + b*y, y' = c*x + d*y), replacing rotate and scale."""
+        if a == None:
+            return self.ptr.get_matrix()
+        self.ptr.set_matrix(a, b, c, d)
+
+    def parent(self, p:'str|Bus|None' = None) -> None | str:
+        """Gets the parent bus, or mixes this bus into p; '' goes back to device channels."""
+        if p == None:
+            return self.ptr.get_parent()
+        self.ptr.set_parent(Bus._busName(p))
+
+    def ch(self, c:list[int]|None = None) -> None | list[int]:
+        """Gets or sets the device channels X and Y go to when the bus has no parent."""
+        if c == None:
+            return self.ptr.get_channels()
+        self.ptr.set_channels(c)
+
+    def oversample(self, factor:int|None = None) -> None | int:
+        """Gets or sets the oversampling factor (1, 2, 4 or 8) for synths drawn through the bus."""
+        if factor == None:
+            return self.ptr.get_oversampling()
+        self.ptr.set_oversampling(factor)
+
 class Master(metaclass=EngineBoundType):
     """A class for controlling global engine parameters."""
     def __init__(self):
@@ -298,13 +574,151 @@ class Master(metaclass=EngineBoundType):
         else:
             self.engine.set_master_volume(v)
 
+    def renderThreads(self, n:int|None = None, deadline:float = 0.5) -> None | int:
+        """Gets or sets the number of worker threads used to render synths (0 = render on the audio thread only)."""
+        if n == None:
+            return self.engine.get_render_threads()
+        else:
+            self.engine.set_render_threads(n, deadline)
+
+    def sampleTime(self) -> int:
+        """Returns the engine's master clock in samples, for scheduling changes with `at`."""
+        return self.engine.sample_time()
+
+    def batch(self, updates:list[tuple]) -> None:
+        """Applies (synth, param, value[, sample_time]) updates in one engine call, landing on the same buffer.
+
+        param is a Param name: 'frequency', 'smooth_frequency', 'amplitude', 'phase_offset', 'position', 'start' or 'stop'.
+        """
+        handles = np.array([(u[0].ptr if isinstance(u[0], Synth) else u[0]).handle() for u in updates], dtype=np.uint32)
+        params = np.array([int(oscar_server.Param.__members__[u[1]]) for u in updates], dtype=np.int32)
+        values = np.array([u[2] for u in updates], dtype=np.float64)
+        times = None
+        if any(len(u) > 3 for u in updates):
+            times = np.array([u[3] if len(u) > 3 else 0 for u in updates], dtype=np.uint64)
+        self.engine.apply_batch(handles, params, values, times)
+
+    def store(self, name:str) -> None:
+        """Snapshots every synth, bus, patch and modulation, plus the master volume, as scene `name`."""
+        self.engine.store_scene(name)
+
+    def recall(self, name:str, fade:float = 0.0) -> None:
+        """Switches the engine to scene `name` on one buffer boundary, crossfading over `fade` seconds."""
+        self.engine.recall_scene(name, round(fade * self.engine.get_sample_rate()))
+        EngineBoundType._generation += 1
+
+    def scenes(self) -> list[str]:
+        """Returns the names of the stored scenes."""
+        return self.engine.list_scenes()
+
+    def forget(self, name:str) -> None:
+        """Deletes stored scene `name`."""
+        self.engine.delete_scene(name)
+
+    def saveScenes(self, path:str) -> None:
+        """Writes every stored scene to a file."""
+        self.engine.save_scenes(path)
+
+    def loadScenes(self, path:str) -> list[str]:
+        """Adds the scenes in a saved file, replacing any with the same names, and returns their names."""
+        return self.engine.load_scenes(path)
+
+    def render(self, seconds:float) -> np.ndarray:
+        """Offline engines: renders the next `seconds` of output as a (frames, channels) array."""
+        return self.engine.render(round(seconds * self.engine.get_sample_rate()))
+
+    def renderToFile(self, path:str, seconds:float, fmt:str = 'wav') -> None:
+        """Offline engines: renders the next `seconds` of output to a 32-bit float 'wav' or 'raw' file."""
+        self.engine.render_to_file(path, round(seconds * self.engine.get_sample_rate()), fmt)
+
+    def stats(self, reset:bool = False) -> dict:
+        """Returns the engine's callback timing, xrun counts and CPU load, optionally clearing them afterwards."""
+        stats = self.engine.stats()
+        if reset:
+            self.engine.reset_stats()
+        return stats
+
+    def reportStats(self, renderer:'Renderer', every:float = 1.0) -> None:
+        """Sends stats() to the renderer as /engine/<name> OSC messages every `every` seconds (0 stops)."""
+        if every <= 0:
+            self.removeClockAction('engine_stats')
+            return
+        last = [0.0]
+        def send(t):
+            if t - last[0] < every:
+                return
+            last[0] = t
+            for name, value in self.engine.stats().items():
+                renderer.client.send_message(f'/engine/{name}', float(value))
+        self.registerClockAction({'engine_stats': send})
+
+    def tap(self, name:str|None = 'oscar-tap', seconds:float = 1.0) -> None:
+        """Publishes the final mix into a shared-memory ring the renderer can read directly (None closes it)."""
+        self.engine.set_output_tap(name or '', seconds)
+
+    def capture(self, seconds:float = 1.0) -> None:
+        """Keeps the last `seconds` of engine output for output() (0 turns it off)."""
+        self.engine.set_capture(seconds)
+
+    def output(self, seconds:float = 0.05) -> np.ndarray:
+        """Returns the latest `seconds` of output as a read-only (channels, frames) view; copy it to keep it."""
+        return self.engine.read_output(round(seconds * self.engine.get_sample_rate()))
+
+    def midiIn(self, port:int = 0) -> None:
+        """Listens to a MIDI input port in the engine; bound messages never reach Python."""
+        self.engine.open_midi_input(port)
+
+    def oscIn(self, port:int, host:str = '127.0.0.1') -> None:
+        """Listens for OSC messages over UDP in the engine."""
+        self.engine.open_osc_input(port, host)
+
+    def bindCC(self, cc:int, synth:'Synth|str', param:str, lo:float = 0.0, hi:float = 1.0, channel:int = -1) -> None:
+        """Maps a MIDI controller onto a synth Param ('frequency', 'amplitude', ...), scaled to [lo, hi]."""
+        self.engine.bind_midi_cc(cc, synth.name() if isinstance(synth, Synth) else synth, oscar_server.Param.__members__[param], channel, lo, hi)
+
+    def bindBend(self, synth:'Synth|str', param:str, lo:float = 0.0, hi:float = 1.0, channel:int = -1) -> None:
+        """Maps MIDI pitch bend onto a synth Param, scaled to [lo, hi]."""
+        self.engine.bind_midi_pitch_bend(synth.name() if isinstance(synth, Synth) else synth, oscar_server.Param.__members__[param], channel, lo, hi)
+
+    def bindNotes(self, synth:'PolySynth|str', channel:int = -1) -> None:
+        """Plays a PolySynth from MIDI notes on `channel` (-1 for any)."""
+        self.engine.bind_midi_notes(synth.name() if isinstance(synth, Synth) else synth, channel)
+
+    def bindOsc(self, address:str, synth:'Synth|str', param:str, lo:float = 0.0, hi:float = 1.0) -> None:
+        """Maps the first argument of OSC messages to `address` onto a synth Param, as lo + (hi - lo) * x."""
+        self.engine.bind_osc(address, synth.name() if isinstance(synth, Synth) else synth, oscar_server.Param.__members__[param], lo, hi)
+
+    def unbindInput(self) -> None:
+        """Removes every MIDI and OSC binding."""
+        self.engine.clear_input_bindings()
+
+    def onInput(self, midi:Callable|None = None, osc:Callable|None = None) -> None:
+        """Handles unbound input: midi(mido.Message) and osc(address, *args). No arguments removes the handlers."""
+        if midi is None and osc is None:
+            self.engine.set_input_callback(None)
+            return
+        def dispatch(kind, address, values):
+            if kind == 'midi' and midi is not None:
+                midi(mido.Message.from_bytes(values))
+            elif kind == 'osc' and osc is not None:
+                osc(address, *values)
+        self.engine.set_input_callback(dispatch)
+
     def getSynths(self) -> list[str]:
         """Returns a list of all synths currently in use."""
         return self.engine.list_synths()
 
+    def getModulations(self) -> list[tuple]:
+        """Returns (source, target, param, depth) for every modulation route."""
+        return self.engine.list_modulations()
+
     def getPatches(self) -> list[str]:
         """Returns a list of all patches currently in use."""
         return self.engine.list_patches()
+
+    def getBuses(self) -> list[str]:
+        """Returns a list of all buses currently in use."""
+        return self.engine.list_buses()
     
     def registerClockAction(self, action: dict) -> None:
         self.clockActions.update(action)
@@ -335,8 +749,24 @@ class Master(metaclass=EngineBoundType):
         self.engine.shutdown()
 
 
-def run(emulator=True, nCh=4):
-    """The main entry point for the Oscar live coding environment."""
+def offline(sample_rate:float = 48000, nCh:int = 4, block_size:int = 512) -> Master:
+    """Starts a headless engine with no audio device and returns its Master, for scripted renders."""
+    engine = oscar_server.AudioEngine.offline(sample_rate, nCh, block_size)
+    Synth.bind_engine(engine)
+    Patch.bind_engine(engine)
+    Bus.bind_engine(engine)
+    Master.bind_engine(engine)
+    return Master()
+
+
+def run(emulator=True, nCh=4, sampleRate:float|None = None, bufferSize:int|None = None, latency:float|None = None, sampleFormat:str = 'float32'):
+    """The main entry point for the Oscar live coding environment.
+
+    sampleRate (Hz), bufferSize (frames) and latency (seconds) override the
+    device defaults; the host's actual choices are printed once the stream opens.
+    sampleFormat ('float32', 'int32', 'int24' or 'int16') selects integer output
+    for DACs that take it natively; the engine clips and dithers it itself.
+    """
     print("Discovering audio devices...")
     try:
         oscar_server.initialize()
@@ -388,11 +818,18 @@ def run(emulator=True, nCh=4):
                 sys.exit(0)
 
     chosen_device = devices[chosen_index]
-    engine = oscar_server.AudioEngine(chosen_index, chosen_device.max_output_channels)
+    config = oscar_server.StreamConfig()
+    config.sample_rate = sampleRate or 0
+    config.frames_per_buffer = bufferSize or 0
+    config.suggested_latency = latency or 0
+    config.sample_format = oscar_server.SampleFormat.__members__[sampleFormat]
+    engine = oscar_server.AudioEngine(chosen_index, chosen_device.max_output_channels, config)
+    print(engine.stream_info())
    
     # Bind the audio engine to the high-level classes.
     Synth.bind_engine(engine)
     Patch.bind_engine(engine)
+    Bus.bind_engine(engine)
     Master.bind_engine(engine)
     
     print("\nEngine Initialization Completed\n")
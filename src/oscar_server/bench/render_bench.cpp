@@ -0,0 +1,164 @@
+// Microbenchmarks for the render hot path, run against the extension's own
+// sources on a headless (offline) engine so no audio device is needed.
+//
+// Results are printed as JSON by default; pass --benchmark_format=console to
+// read them, or --benchmark_out=<file> to keep a copy for comparison with
+// Google Benchmark's tools/compare.py.
+
+#include <benchmark/benchmark.h>
+#include <pybind11/embed.h>
+
+#include "../main.cpp"
+
+namespace {
+
+constexpr double kSampleRate = 48000.0;
+constexpr unsigned long kBlockFrames = 512;
+
+// A saw, so every mip level has content to filter.
+std::unique_ptr<const Wavetable> saw_table(std::size_t size) {
+    std::vector<float> data(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        data[i] = 2.f * static_cast<float>(i) / static_cast<float>(size) - 1.f;
+    }
+    return std::make_unique<const Wavetable>(data.data(), size);
+}
+
+// An offline engine with `patches` running synths, each patched to two
+// neighbouring channels.
+std::unique_ptr<AudioEngine> patched_engine(int channels, int patches) {
+    auto engine = AudioEngine::offline(kSampleRate, channels, kBlockFrames);
+    for (int i = 0; i < patches; ++i) {
+        const std::string name = "s" + std::to_string(i);
+        auto synth = engine->get_or_create_synth(name, saw_table(2048));
+        synth->set_frequency(55.0 + 13.0 * i);
+        synth->set_amplitude(1.0 / patches);
+        synth->start();
+        engine->get_or_create_patch("p" + std::to_string(i), name, {i % channels, (i + 1) % channels});
+    }
+    return engine;
+}
+
+// Synth::render on its own, per table size.
+void BM_SynthRender(benchmark::State& state) {
+    Synth synth(kSampleRate, saw_table(static_cast<std::size_t>(state.range(0))));
+    synth.set_frequency(440.0);
+    std::vector<float> out(kBlockFrames);
+    double phase = 0.0;
+    for (auto _ : state) {
+        synth.render(out.data(), kBlockFrames, phase);
+        phase += kBlockFrames;
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * kBlockFrames);
+}
+BENCHMARK(BM_SynthRender)->RangeMultiplier(4)->Range(256, 65536);
+
+// Synth::render per interpolation mode and table size, e.g. to check that a
+// small Hermite table beats a large linear one.
+void BM_SynthInterpolation(benchmark::State& state) {
+    Synth synth(kSampleRate, saw_table(static_cast<std::size_t>(state.range(1))));
+    synth.set_frequency(440.0);
+    synth.set_interpolation(static_cast<Interpolation>(state.range(0)));
+    std::vector<float> out(kBlockFrames);
+    double phase = 0.0;
+    for (auto _ : state) {
+        synth.render(out.data(), kBlockFrames, phase);
+        phase += kBlockFrames;
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * kBlockFrames);
+}
+BENCHMARK(BM_SynthInterpolation)->ArgsProduct({{0, 1, 2, 3}, {256, 2048, 65536}});
+
+// Synth::render per oversampling factor, decimation included.
+void BM_SynthOversampling(benchmark::State& state) {
+    Synth synth(kSampleRate, saw_table(2048));
+    synth.set_frequency(440.0);
+    const auto factor = static_cast<unsigned>(state.range(0));
+    std::vector<float> out(kBlockFrames);
+    double phase = 0.0;
+    for (auto _ : state) {
+        synth.render(out.data(), kBlockFrames, phase, nullptr, factor);
+        phase += kBlockFrames;
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * kBlockFrames);
+}
+BENCHMARK(BM_SynthOversampling)->RangeMultiplier(2)->Range(1, 8);
+
+// The whole callback: rendering every synth and mixing it onto the bus.
+void BM_MixLoop(benchmark::State& state) {
+    const int channels = static_cast<int>(state.range(0));
+    const int patches = static_cast<int>(state.range(1));
+    auto engine = patched_engine(channels, patches);
+    std::vector<float> out(kBlockFrames * channels);
+    for (auto _ : state) {
+        engine->render_into(out.data(), kBlockFrames);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * kBlockFrames);
+}
+BENCHMARK(BM_MixLoop)->ArgsProduct({{2, 4, 8, 16, 32}, {1, 4, 16, 64, 256}});
+
+// Posting a burst of setter commands and applying them in the next block.
+void BM_CommandThroughput(benchmark::State& state) {
+    const int commands = static_cast<int>(state.range(0));
+    auto engine = patched_engine(4, 64);
+    std::vector<std::shared_ptr<Synth>> synths;
+    for (int i = 0; i < 64; ++i) synths.push_back(engine->get_or_create_synth("s" + std::to_string(i), saw_table(256)));
+    std::vector<float> out(kBlockFrames * 4);
+    double freq = 100.0;
+    for (auto _ : state) {
+        for (int c = 0; c < commands; ++c) {
+            synths[c % synths.size()]->set_frequency(freq);
+        }
+        engine->render_into(out.data(), kBlockFrames);
+        freq = freq < 1000.0 ? freq + 1.0 : 100.0;
+    }
+    state.SetItemsProcessed(state.iterations() * commands);
+}
+BENCHMARK(BM_CommandThroughput)->RangeMultiplier(4)->Range(1, 1024);
+
+// Building a table and its mip levels, which happens on the caller's thread.
+void BM_WavetableBuild(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(saw_table(static_cast<std::size_t>(state.range(0))));
+    }
+}
+BENCHMARK(BM_WavetableBuild)->RangeMultiplier(4)->Range(256, 65536);
+
+// From publishing a prebuilt table to the audio thread playing it, including
+// the block that picks it up and freeing the table it replaced.
+void BM_WavetableSwap(benchmark::State& state) {
+    const auto size = static_cast<std::size_t>(state.range(0));
+    auto engine = patched_engine(2, 1);
+    auto synth = engine->get_or_create_synth("s0", saw_table(size));
+    std::vector<float> out(kBlockFrames * 2);
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto table = saw_table(size);
+        state.ResumeTiming();
+        synth->install_wavetable(std::move(table));
+        engine->render_into(out.data(), kBlockFrames);
+    }
+}
+BENCHMARK(BM_WavetableSwap)->RangeMultiplier(4)->Range(256, 65536);
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    // The engine reports through py::print, so it needs an interpreter; its
+    // messages are sent to devnull to keep the JSON clean.
+    py::scoped_interpreter interpreter;
+    py::module_::import("sys").attr("stdout") = py::module_::import("builtins").attr("open")(py::module_::import("os").attr("devnull"), "w");
+
+    std::vector<char*> args{argv[0], const_cast<char*>("--benchmark_format=json")};
+    args.insert(args.end(), argv + 1, argv + argc);
+    int num_args = static_cast<int>(args.size());
+    benchmark::Initialize(&num_args, args.data());
+    if (benchmark::ReportUnrecognizedArguments(num_args, args.data())) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
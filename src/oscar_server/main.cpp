@@ -2,6 +2,19 @@
 #include <pybind11/stl.h>
 #include <pybind11/numpy.h>
 #include <portaudio.h>
+// Host-API extensions, when the PortAudio build ships them.
+#if defined(__APPLE__) && __has_include(<pa_mac_core.h>)
+#include <pa_mac_core.h>
+#define OSCAR_PA_MAC_CORE 1
+#endif
+#if defined(_WIN32) && __has_include(<pa_asio.h>)
+#include <pa_asio.h>
+#define OSCAR_PA_ASIO 1
+#endif
+#if __has_include(<pa_jack.h>)
+#include <pa_jack.h>
+#define OSCAR_PA_JACK 1
+#endif
 #include <iostream>
 #include <vector>
 #include <string>
@@ -11,6 +24,63 @@
 #include <algorithm>
 #include <mutex>
 #include <map>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <new>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <complex>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#endif
+
+// Native MIDI input, when setup.py found RtMidi.
+#if defined(OSCAR_RTMIDI) && __has_include(<RtMidi.h>)
+#include <RtMidi.h>
+#define OSCAR_HAVE_RTMIDI 1
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define OSCAR_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define OSCAR_TARGET_AVX2
+#else
+#define OSCAR_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define OSCAR_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -24,6 +94,31 @@ struct DeviceInfo {
     int index;
     std::string name;
     int maxOutputChannels;
+    std::string hostApi;
+    double defaultSampleRate;
+    double defaultLowOutputLatency;
+    double defaultHighOutputLatency;
+};
+
+// Sample format of the host buffer. Integer formats are written (clipped and
+// dithered) by the engine's own output pass, so PortAudio does no conversion.
+enum class SampleFormat { Float32, Int32, Int24, Int16 };
+
+// Output stream settings for AudioEngine. Zeros mean "let the device or host
+// decide": its default sample rate, its low output latency, and whatever
+// buffer size the host prefers.
+struct StreamConfig {
+    double sample_rate = 0.0;
+    unsigned long frames_per_buffer = 0;
+    double suggested_latency = 0.0;   // seconds
+    SampleFormat sample_format = SampleFormat::Float32;
+    bool dither = true;               // TPDF dither for int16/int24 output
+    // Host-API specific. channel_selectors picks which device outputs the
+    // engine's channels land on (ASIO and CoreAudio); mac_core_flags are
+    // paMacCore* flags (e.g. paMacCoreChangeDeviceParameters to switch the
+    // device to the requested rate rather than resample).
+    std::vector<int> channel_selectors;
+    unsigned long mac_core_flags = 0;
 };
 
 void pa_check_error(PaError err, const std::string& message) {
@@ -32,7 +127,110 @@ void pa_check_error(PaError err, const std::string& message) {
     }
 }
 
-void initialize() {
+// --- Real-time allocation checking ---
+// Built with OSCAR_RT_ALLOC_CHECK defined, the global allocator is replaced
+// with one that counts every allocation/deallocation made while the current
+// thread is inside the audio callback. OSCAR_RT_ALLOC_ABORT additionally
+// aborts on the first one so it can be caught in a debugger.
+
+#if defined(OSCAR_RT_ALLOC_CHECK) && !defined(_WIN32)
+namespace rt_alloc {
+    static thread_local bool on_audio_thread = false;
+    static std::atomic<long long> count{0};
+
+    static void note() {
+        if (!on_audio_thread) return;
+        count.fetch_add(1, std::memory_order_relaxed);
+#ifdef OSCAR_RT_ALLOC_ABORT
+        std::fputs("oscar_server: heap allocation on the audio thread\n", stderr);
+        std::abort();
+#endif
+    }
+
+    static void* allocate(std::size_t size, std::size_t alignment) {
+        note();
+        void* p = nullptr;
+        if (posix_memalign(&p, std::max(alignment, sizeof(void*)), size ? size : 1) != 0) throw std::bad_alloc();
+        return p;
+    }
+
+    static void release(void* p) {
+        if (p == nullptr) return;
+        note();
+        std::free(p);
+    }
+}
+
+void* operator new(std::size_t size) { return rt_alloc::allocate(size, alignof(std::max_align_t)); }
+void* operator new[](std::size_t size) { return rt_alloc::allocate(size, alignof(std::max_align_t)); }
+void* operator new(std::size_t size, std::align_val_t al) { return rt_alloc::allocate(size, static_cast<std::size_t>(al)); }
+void* operator new[](std::size_t size, std::align_val_t al) { return rt_alloc::allocate(size, static_cast<std::size_t>(al)); }
+void operator delete(void* p) noexcept { rt_alloc::release(p); }
+void operator delete[](void* p) noexcept { rt_alloc::release(p); }
+void operator delete(void* p, std::size_t) noexcept { rt_alloc::release(p); }
+void operator delete[](void* p, std::size_t) noexcept { rt_alloc::release(p); }
+void operator delete(void* p, std::align_val_t) noexcept { rt_alloc::release(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { rt_alloc::release(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { rt_alloc::release(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { rt_alloc::release(p); }
+
+long long rt_allocation_count() { return rt_alloc::count.load(); }
+
+// Marks the enclosing scope as running on the audio thread.
+struct AudioThreadScope {
+    AudioThreadScope() { rt_alloc::on_audio_thread = true; }
+    ~AudioThreadScope() { rt_alloc::on_audio_thread = false; }
+};
+#else
+long long rt_allocation_count() { return -1; }
+
+struct AudioThreadScope {};
+#endif
+
+
+// Fixed, 64-byte aligned float scratch memory for the render path. Sized once
+// on the control thread when the stream is opened; the audio thread only ever
+// hands out pointers into it.
+class ScratchArena {
+private:
+    static constexpr std::size_t kAlignment = 64;
+    static constexpr std::size_t kStride = kAlignment / sizeof(float);
+
+    struct AlignedDelete {
+        void operator()(float* p) const { ::operator delete(p, std::align_val_t{kAlignment}); }
+    };
+
+    std::unique_ptr<float, AlignedDelete> storage_;
+    std::size_t max_frames_{0};
+    std::size_t lane_stride_{0};
+    std::size_t num_lanes_{0};
+
+public:
+    void allocate(std::size_t num_lanes, std::size_t max_frames) {
+        lane_stride_ = (max_frames + kStride - 1) / kStride * kStride;
+        const std::size_t count = std::max<std::size_t>(lane_stride_ * num_lanes, 1);
+        storage_.reset(static_cast<float*>(::operator new(count * sizeof(float), std::align_val_t{kAlignment})));
+        std::fill_n(storage_.get(), count, 0.f);
+        max_frames_ = max_frames;
+        num_lanes_ = num_lanes;
+    }
+
+    float* lane(std::size_t index) const { return storage_.get() + index * lane_stride_; }
+    std::size_t max_frames() const { return max_frames_; }
+    std::size_t num_lanes() const { return num_lanes_; }
+};
+
+
+// `jack_client_name` names the engine in JACK, which PortAudio only accepts
+// before initializing.
+void initialize(const std::string& jack_client_name) {
+    if (!jack_client_name.empty()) {
+#ifdef OSCAR_PA_JACK
+        pa_check_error(PaJack_SetClientName(jack_client_name.c_str()), "Failed to set JACK client name");
+#else
+        throw std::runtime_error("This PortAudio build has no JACK support.");
+#endif
+    }
     pa_check_error(Pa_Initialize(), "Failed to initialize PortAudio");
     py::print("PortAudio initialized.");
 }
@@ -49,162 +247,4090 @@ std::vector<DeviceInfo> getDeviceDetails() {
     for (int i = 0; i < numDevices; ++i) {
         const PaDeviceInfo* deviceInfo = Pa_GetDeviceInfo(i);
         if (deviceInfo) {
-            deviceDetails.push_back({i, std::string(deviceInfo->name), deviceInfo->maxOutputChannels});
+            const PaHostApiInfo* hostApi = Pa_GetHostApiInfo(deviceInfo->hostApi);
+            deviceDetails.push_back({i, std::string(deviceInfo->name), deviceInfo->maxOutputChannels,
+                                     hostApi ? std::string(hostApi->name) : std::string(),
+                                     deviceInfo->defaultSampleRate, deviceInfo->defaultLowOutputLatency,
+                                     deviceInfo->defaultHighOutputLatency});
         }
     }
     return deviceDetails;
 }
 
 
-class Synth : public std::enable_shared_from_this<Synth> {
-private:
-    std::atomic<bool> is_playing_{false};
-    std::atomic<double> phase_offset_{0.f};
-    double sample_rate_;
-    std::atomic<double> amplitude_{0.5f};
-    std::atomic<double> frequency_{440.f};
-    std::vector<float> wavetable_;
-    std::atomic<double> master_phase_{0.f};
+// --- Wavetable oscillator kernels ---
+// Tables are stored with a power-of-two length plus guard samples, and the
+// oscillator phase is a 0.32 fixed-point cycle position. The top table_bits of
+// the phase are the table index and the rest the interpolation fraction, so
+// wrapping is free (integer overflow) and there is no fmod or modulo per
+// sample. One kernel per instruction set and interpolation mode; the best
+// instruction set the CPU supports is picked once at load time.
 
-public:
-    Synth(double sample_rate, std::vector<float> table) : 
-        sample_rate_(sample_rate),
-        wavetable_(std::move(table))
-    {   
-        //setFrequency(this->frequency_);
-        if (wavetable_.empty()) {
-            wavetable_.push_back(0.f);
+constexpr unsigned kMinTableBits = 1;
+constexpr unsigned kMaxTableBits = 20;
+constexpr std::size_t kTableLead = 3;    // readable samples before the start of the table
+constexpr std::size_t kTableGuard = 4;   // readable samples past the end of the table
+
+// How samples between table entries are read. Each mode is its own kernel,
+// so the choice costs nothing per sample. Hermite and Sinc get more out of
+// small tables, which stay in cache, than Linear does out of large ones.
+enum class Interpolation : uint8_t {
+    None,     // nearest entry below the phase
+    Linear,   // 2 points
+    Hermite,  // 4-point, 3rd-order (Catmull-Rom)
+    Sinc,     // 8-point Blackman-windowed sinc
+};
+constexpr std::size_t kNumInterpolations = 4;
+
+struct OscillatorBlock {
+    const float* table;   // kTableLead + (1 << table_bits) + kTableGuard samples, from its first entry
+    unsigned table_bits;
+    uint32_t phase;       // phase of the first output sample
+    uint32_t increment;   // per-sample phase step
+    float amplitude;
+    // Wavetable sets: the frame above `table`, blended in by `morph`. The
+    // kernels only read `table`; oscillate() does the blend.
+    const float* next_table{nullptr};
+    float morph{0.f};
+    Interpolation interpolation{Interpolation::Linear};
+};
+
+using OscillatorKernel = void (*)(const OscillatorBlock&, float* out, unsigned long frames);
+
+inline uint32_t to_fixed_phase(double cycles) {
+    cycles -= std::floor(cycles);
+    return static_cast<uint32_t>(static_cast<uint64_t>(cycles * 4294967296.0));
+}
+
+// 0.64 fixed-point version, for phases that are carried across blocks.
+inline uint64_t to_fixed_phase64(double cycles) {
+    cycles -= std::floor(cycles);
+    const double scaled = cycles * 4294967296.0;
+    const double hi = std::floor(scaled);
+    const double lo = (scaled - hi) * 4294967296.0;
+    return (static_cast<uint64_t>(hi) << 32) + static_cast<uint64_t>(lo);
+}
+
+// Length (as a power of two) that a source table of `size` samples is stored at.
+inline unsigned wavetable_bits(std::size_t size) {
+    unsigned bits = kMinTableBits;
+    while ((std::size_t{1} << bits) < size && bits < kMaxTableBits) ++bits;
+    return bits;
+}
+
+// Copies the ends of a table into the guard samples either side of it.
+inline void wrap_table_guards(float* table, std::size_t table_size) {
+    const std::size_t mask = table_size - 1;
+    for (std::size_t g = 0; g < kTableGuard; ++g) table[table_size + g] = table[g & mask];
+    for (std::size_t g = 1; g <= kTableLead; ++g) *(table - g) = table[(table_size - g) & mask];
+}
+
+// Resamples the source to 1 << bits samples, if it isn't that long already,
+// and fills in the guard samples. `table` points kTableLead samples into a
+// buffer of kTableLead + (1 << bits) + kTableGuard.
+void prepare_wavetable(const float* data, std::size_t size, unsigned bits, float* table) {
+    if (size == 0) {
+        static const float silence = 0.f;
+        data = &silence;
+        size = 1;
+    }
+    const std::size_t table_size = std::size_t{1} << bits;
+
+    if (table_size == size) {
+        std::copy(data, data + size, table);
+    } else {
+        const double step = static_cast<double>(size) / static_cast<double>(table_size);
+        for (std::size_t i = 0; i < table_size; ++i) {
+            const double pos = i * step;
+            const std::size_t i0 = static_cast<std::size_t>(pos);
+            const float frac = static_cast<float>(pos - i0);
+            const float v0 = data[i0 % size];
+            const float v1 = data[(i0 + 1) % size];
+            table[i] = v0 + frac * (v1 - v0);
         }
     }
-    virtual ~Synth() = default;
+    wrap_table_guards(table, table_size);
+}
 
-    Synth(const Synth&) = delete;
-    Synth& operator=(const Synth&) = delete;
+// Sinc taps cover entries -3 to +4 around the read position. Coefficients are
+// tabulated at kSincPhases fractions and interpolated between them: row p
+// holds the taps at fraction p / kSincPhases, then the step to row p + 1, so
+// one sample reads one 64-byte line.
+constexpr int kSincTaps = 8;
+constexpr int kSincPhases = 128;
 
-    void render(float* mono_out, unsigned long frames, double master_phase_start) {
-        if (wavetable_.empty()) return;
-        double table_size = static_cast<double>(wavetable_.size());
-        double current_master_phase = master_phase_start;
-        double freq = frequency_.load();
-        double amp = amplitude_.load();
-        double sample_offset = phase_offset_.load() * table_size;
-        for (unsigned long i=0; i<frames; ++i) {
-            double total_cycles = (current_master_phase * freq) / this->sample_rate_;
-            double phase_with_offset = (total_cycles * table_size) + sample_offset;
-            double phase_wrapped = fmod(phase_with_offset, table_size);
-            if (phase_wrapped < 0) phase_wrapped += table_size;
-            unsigned int i0 = static_cast<unsigned int>(phase_wrapped);
-            unsigned int i1 = (i0 + 1) % wavetable_.size(); // table_size instead?
-            double frac = phase_wrapped - i0;
-            float val0 = wavetable_[i0];
-            float val1 = wavetable_[i1];
-            float current_sample = static_cast<float>(val0 + frac * (val1 - val0));
-            mono_out[i] = current_sample * amp;
-            current_master_phase += 1.f; //externally tracked, just accounting locally here
-        }
-
-    }
-
-    void start() { is_playing_.store(true); }
-    void stop() { is_playing_.store(false); }
-    bool is_playing() const { return is_playing_.load(); }
-    void set_frequency(double freq) { this->frequency_.store(freq); }
-    double get_frequency() const { return frequency_; }
-    void set_amplitude(double amp) { this->amplitude_.store(amp); }
-    double get_amplitude() const { return amplitude_; }
-    void update_wavetable(std::vector<float> new_table) {
-        //TODO check that length is ok?
-        wavetable_.clear();
-        wavetable_.insert(wavetable_.end(), new_table.begin(), new_table.end());
+struct SincTable {
+    alignas(64) float rows[kSincPhases][2 * kSincTaps];
+
+    SincTable() {
+        float taps[kSincPhases + 1][kSincTaps];
+        for (int p = 0; p <= kSincPhases; ++p) {
+            const double frac = static_cast<double>(p) / kSincPhases;
+            double sum = 0.0;
+            for (int k = 0; k < kSincTaps; ++k) {
+                const double x = static_cast<double>(k - 3) - frac;
+                const double sinc = x == 0.0 ? 1.0 : std::sin(M_PI * x) / (M_PI * x);
+                const double w = 0.42 + 0.5 * std::cos(M_PI * x / 4.0) + 0.08 * std::cos(2.0 * M_PI * x / 4.0);
+                taps[p][k] = static_cast<float>(sinc * w);
+                sum += sinc * w;
+            }
+            for (int k = 0; k < kSincTaps; ++k) taps[p][k] = static_cast<float>(taps[p][k] / sum);  // unity gain at DC
+        }
+        for (int p = 0; p < kSincPhases; ++p) {
+            for (int k = 0; k < kSincTaps; ++k) {
+                rows[p][k] = taps[p][k];
+                rows[p][kSincTaps + k] = taps[p + 1][k] - taps[p][k];
+            }
+        }
     }
-    void set_phase_offset(double offset) { this->phase_offset_.store(offset); }
-    double get_phase_offset() const { return phase_offset_.load(); }
-    void set_master_phase(double phase) { master_phase_.store(phase); }
-    double get_master_phase() const { return master_phase_.load(); }
+};
 
-    void smooth_set_frequency(double new_freq) {
-        const double old_freq = frequency_.load();
-        const double old_phase_offset = phase_offset_.load();
+static const SincTable& sinc_table() {
+    static const SincTable table;
+    return table;
+}
 
-        // Calculate time using the internal master phase
-        const double time_at_change = master_phase_.load() / sample_rate_;
+// One interpolated read at entry i0 plus `frac` of the next.
+template <Interpolation Mode>
+inline float interpolate(const float* table, uint32_t i0, float frac) {
+    const float* s = table + i0;
+    if constexpr (Mode == Interpolation::None) {
+        return s[0];
+    } else if constexpr (Mode == Interpolation::Linear) {
+        return s[0] + frac * (s[1] - s[0]);
+    } else if constexpr (Mode == Interpolation::Hermite) {
+        const float c1 = 0.5f * (s[1] - s[-1]);
+        const float c2 = s[-1] - 2.5f * s[0] + 2.f * s[1] - 0.5f * s[2];
+        const float c3 = 0.5f * (s[2] - s[-1]) + 1.5f * (s[0] - s[1]);
+        return ((c3 * frac + c2) * frac + c1) * frac + s[0];
+    } else {
+        const float pos = frac * kSincPhases;
+        const int p = std::min(static_cast<int>(pos), kSincPhases - 1);
+        const float w = pos - static_cast<float>(p);
+        const float* row = sinc_table().rows[p];
+        float sum = 0.f;
+        for (int k = 0; k < kSincTaps; ++k) sum += (row[k] + w * row[kSincTaps + k]) * s[k - 3];
+        return sum;
+    }
+}
 
-        // Calculate the necessary phase shift: p_new = p_old + t * (f_old - f_new)
-        const double phase_correction = time_at_change * (old_freq - new_freq);
-        double new_phase_offset = old_phase_offset + phase_correction;
+template <Interpolation Mode>
+static void oscillator_scalar_span(const OscillatorBlock& b, uint32_t phase, float* out, unsigned long frames) {
+    const unsigned shift = 32 - b.table_bits;
+    const uint32_t frac_mask = (uint32_t{1} << shift) - 1;
+    const float frac_scale = std::ldexp(1.f, -static_cast<int>(shift));
+    for (unsigned long i = 0; i < frames; ++i) {
+        const uint32_t i0 = phase >> shift;
+        const float frac = static_cast<float>(phase & frac_mask) * frac_scale;
+        out[i] = interpolate<Mode>(b.table, i0, frac) * b.amplitude;
+        phase += b.increment;
+    }
+}
 
-        // Wrap the phase offset to the [0.0, 1.0) range
-        new_phase_offset = fmod(new_phase_offset, 1.0);
-        if (new_phase_offset < 0.0) {
-            new_phase_offset += 1.0;
+template <Interpolation Mode>
+static void oscillator_scalar(const OscillatorBlock& b, float* out, unsigned long frames) {
+    oscillator_scalar_span<Mode>(b, b.phase, out, frames);
+}
+
+#if defined(OSCAR_SIMD_X86)
+// Sums the 8 (SSE2: two 4-lane halves of the) sinc taps for one sample.
+static inline float sinc_sse2(const float* table, uint32_t i0, int p, float w) {
+    const float* s = table + i0 - 3;
+    const float* row = sinc_table().rows[p];
+    const __m128 wv = _mm_set1_ps(w);
+    const __m128 c0 = _mm_add_ps(_mm_load_ps(row), _mm_mul_ps(wv, _mm_load_ps(row + kSincTaps)));
+    const __m128 c1 = _mm_add_ps(_mm_load_ps(row + 4), _mm_mul_ps(wv, _mm_load_ps(row + kSincTaps + 4)));
+    __m128 sum = _mm_add_ps(_mm_mul_ps(c0, _mm_loadu_ps(s)), _mm_mul_ps(c1, _mm_loadu_ps(s + 4)));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+
+template <Interpolation Mode>
+static void oscillator_sse2(const OscillatorBlock& b, float* out, unsigned long frames) {
+    const unsigned shift = 32 - b.table_bits;
+    const __m128i shift_count = _mm_cvtsi32_si128(static_cast<int>(shift));
+    const __m128i frac_mask = _mm_set1_epi32(static_cast<int>((uint32_t{1} << shift) - 1));
+    const __m128 frac_scale = _mm_set1_ps(std::ldexp(1.f, -static_cast<int>(shift)));
+    const __m128 amp = _mm_set1_ps(b.amplitude);
+    const uint32_t p = b.phase, inc = b.increment;
+    __m128i phase = _mm_setr_epi32(static_cast<int>(p), static_cast<int>(p + inc),
+                                   static_cast<int>(p + 2 * inc), static_cast<int>(p + 3 * inc));
+    const __m128i step = _mm_set1_epi32(static_cast<int>(4 * inc));
+    alignas(16) uint32_t idx[4];
+    const float* t = b.table;
+    // The 4 lanes of entry idx + k.
+    auto tap = [&](int k) { return _mm_setr_ps((t + idx[0])[k], (t + idx[1])[k], (t + idx[2])[k], (t + idx[3])[k]); };
+
+    unsigned long i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        _mm_store_si128(reinterpret_cast<__m128i*>(idx), _mm_srl_epi32(phase, shift_count));
+        const __m128 frac = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(phase, frac_mask)), frac_scale);
+        const __m128 v0 = tap(0);
+        __m128 sample;
+        if constexpr (Mode == Interpolation::None) {
+            sample = v0;
+        } else if constexpr (Mode == Interpolation::Linear) {
+            sample = _mm_add_ps(v0, _mm_mul_ps(frac, _mm_sub_ps(tap(1), v0)));
+        } else if constexpr (Mode == Interpolation::Hermite) {
+            const __m128 vm = tap(-1), v1 = tap(1), v2 = tap(2);
+            const __m128 half = _mm_set1_ps(0.5f);
+            const __m128 c1 = _mm_mul_ps(half, _mm_sub_ps(v1, vm));
+            const __m128 c2 = _mm_sub_ps(_mm_add_ps(vm, _mm_add_ps(v1, v1)),
+                                         _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.5f), v0), _mm_mul_ps(half, v2)));
+            const __m128 c3 = _mm_add_ps(_mm_mul_ps(half, _mm_sub_ps(v2, vm)), _mm_mul_ps(_mm_set1_ps(1.5f), _mm_sub_ps(v0, v1)));
+            sample = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(c3, frac), c2), frac), c1), frac), v0);
+        } else {
+            const __m128 pos = _mm_mul_ps(frac, _mm_set1_ps(static_cast<float>(kSincPhases)));
+            const __m128i row = _mm_min_epi16(_mm_cvttps_epi32(pos), _mm_set1_epi32(kSincPhases - 1));  // no 32-bit min in SSE2; rows fit in 16
+            alignas(16) int32_t rows[4];
+            alignas(16) float w[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(rows), row);
+            _mm_store_ps(w, _mm_sub_ps(pos, _mm_cvtepi32_ps(row)));
+            sample = _mm_setr_ps(sinc_sse2(t, idx[0], rows[0], w[0]), sinc_sse2(t, idx[1], rows[1], w[1]),
+                                 sinc_sse2(t, idx[2], rows[2], w[2]), sinc_sse2(t, idx[3], rows[3], w[3]));
         }
+        _mm_storeu_ps(out + i, _mm_mul_ps(sample, amp));
+        phase = _mm_add_epi32(phase, step);
+    }
+    oscillator_scalar_span<Mode>(b, p + static_cast<uint32_t>(i) * inc, out + i, frames - i);
+}
 
-        frequency_.store(new_freq);
-        phase_offset_.store(new_phase_offset);
+template <Interpolation Mode>
+OSCAR_TARGET_AVX2
+static void oscillator_avx2(const OscillatorBlock& b, float* out, unsigned long frames) {
+    const unsigned shift = 32 - b.table_bits;
+    const __m128i shift_count = _mm_cvtsi32_si128(static_cast<int>(shift));
+    const __m256i frac_mask = _mm256_set1_epi32(static_cast<int>((uint32_t{1} << shift) - 1));
+    const __m256 frac_scale = _mm256_set1_ps(std::ldexp(1.f, -static_cast<int>(shift)));
+    const __m256 amp = _mm256_set1_ps(b.amplitude);
+    const uint32_t p = b.phase, inc = b.increment;
+    __m256i phase = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(p)),
+                                     _mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(inc)),
+                                                        _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+    const __m256i step = _mm256_set1_epi32(static_cast<int>(8 * inc));
+    const float* t = b.table;
+
+    unsigned long i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        const __m256i idx = _mm256_srl_epi32(phase, shift_count);
+        const __m256 frac = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(phase, frac_mask)), frac_scale);
+        const __m256 v0 = _mm256_i32gather_ps(t, idx, 4);
+        __m256 sample;
+        if constexpr (Mode == Interpolation::None) {
+            sample = v0;
+        } else if constexpr (Mode == Interpolation::Linear) {
+            const __m256 v1 = _mm256_i32gather_ps(t + 1, idx, 4);
+            sample = _mm256_fmadd_ps(frac, _mm256_sub_ps(v1, v0), v0);
+        } else if constexpr (Mode == Interpolation::Hermite) {
+            const __m256 vm = _mm256_i32gather_ps(t - 1, idx, 4);
+            const __m256 v1 = _mm256_i32gather_ps(t + 1, idx, 4);
+            const __m256 v2 = _mm256_i32gather_ps(t + 2, idx, 4);
+            const __m256 half = _mm256_set1_ps(0.5f);
+            const __m256 c1 = _mm256_mul_ps(half, _mm256_sub_ps(v1, vm));
+            const __m256 c2 = _mm256_sub_ps(_mm256_add_ps(vm, _mm256_add_ps(v1, v1)),
+                                            _mm256_fmadd_ps(_mm256_set1_ps(2.5f), v0, _mm256_mul_ps(half, v2)));
+            const __m256 c3 = _mm256_fmadd_ps(half, _mm256_sub_ps(v2, vm), _mm256_mul_ps(_mm256_set1_ps(1.5f), _mm256_sub_ps(v0, v1)));
+            sample = _mm256_fmadd_ps(_mm256_fmadd_ps(_mm256_fmadd_ps(c3, frac, c2), frac, c1), frac, v0);
+        } else {
+            // Tap by tap across the 8 samples, gathering each sample's coefficients.
+            const __m256 pos = _mm256_mul_ps(frac, _mm256_set1_ps(static_cast<float>(kSincPhases)));
+            const __m256i row = _mm256_min_epi32(_mm256_cvttps_epi32(pos), _mm256_set1_epi32(kSincPhases - 1));
+            const __m256 w = _mm256_sub_ps(pos, _mm256_cvtepi32_ps(row));
+            const __m256i row_offset = _mm256_slli_epi32(row, 4);  // 2 * kSincTaps floats per row
+            const float* rows = &sinc_table().rows[0][0];
+            sample = _mm256_setzero_ps();
+            for (int k = 0; k < kSincTaps; ++k) {
+                const __m256 c = _mm256_fmadd_ps(w, _mm256_i32gather_ps(rows + kSincTaps + k, row_offset, 4),
+                                                 _mm256_i32gather_ps(rows + k, row_offset, 4));
+                sample = _mm256_fmadd_ps(c, _mm256_i32gather_ps(t + k - 3, idx, 4), sample);
+            }
+        }
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(sample, amp));
+        phase = _mm256_add_epi32(phase, step);
+    }
+    oscillator_scalar_span<Mode>(b, p + static_cast<uint32_t>(i) * inc, out + i, frames - i);
+}
+
+static bool cpu_has_avx2_fma() {
+#if defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 1);
+    const bool osxsave = regs[2] & (1 << 27), avx = regs[2] & (1 << 28), fma = regs[2] & (1 << 12);
+    if (!(osxsave && avx && fma) || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(regs, 7, 0);
+    return regs[1] & (1 << 5);
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+#endif
+
+#if defined(OSCAR_SIMD_NEON)
+template <Interpolation Mode>
+static void oscillator_neon(const OscillatorBlock& b, float* out, unsigned long frames) {
+    const unsigned shift = 32 - b.table_bits;
+    const int32x4_t shift_right = vdupq_n_s32(-static_cast<int32_t>(shift));
+    const uint32x4_t frac_mask = vdupq_n_u32((uint32_t{1} << shift) - 1);
+    const float32x4_t frac_scale = vdupq_n_f32(std::ldexp(1.f, -static_cast<int>(shift)));
+    const float32x4_t amp = vdupq_n_f32(b.amplitude);
+    const uint32_t p = b.phase, inc = b.increment;
+    const uint32_t lanes[4] = {p, p + inc, p + 2 * inc, p + 3 * inc};
+    uint32x4_t phase = vld1q_u32(lanes);
+    const uint32x4_t step = vdupq_n_u32(4 * inc);
+    uint32_t idx[4];
+    const float* t = b.table;
+    // The 4 lanes of entry idx + k.
+    auto tap = [&](int k) {
+        const float v[4] = {(t + idx[0])[k], (t + idx[1])[k], (t + idx[2])[k], (t + idx[3])[k]};
+        return vld1q_f32(v);
+    };
+
+    unsigned long i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        vst1q_u32(idx, vshlq_u32(phase, shift_right));
+        const float32x4_t frac = vmulq_f32(vcvtq_f32_u32(vandq_u32(phase, frac_mask)), frac_scale);
+        const float32x4_t v0 = tap(0);
+        float32x4_t sample;
+        if constexpr (Mode == Interpolation::None) {
+            sample = v0;
+        } else if constexpr (Mode == Interpolation::Linear) {
+            sample = vfmaq_f32(v0, frac, vsubq_f32(tap(1), v0));
+        } else if constexpr (Mode == Interpolation::Hermite) {
+            const float32x4_t vm = tap(-1), v1 = tap(1), v2 = tap(2);
+            const float32x4_t c1 = vmulq_n_f32(vsubq_f32(v1, vm), 0.5f);
+            const float32x4_t c2 = vsubq_f32(vaddq_f32(vm, vaddq_f32(v1, v1)), vfmaq_n_f32(vmulq_n_f32(v2, 0.5f), v0, 2.5f));
+            const float32x4_t c3 = vfmaq_n_f32(vmulq_n_f32(vsubq_f32(v2, vm), 0.5f), vsubq_f32(v0, v1), 1.5f);
+            sample = vfmaq_f32(v0, vfmaq_f32(c1, vfmaq_f32(c2, c3, frac), frac), frac);
+        } else {
+            const float32x4_t pos = vmulq_n_f32(frac, static_cast<float>(kSincPhases));
+            const int32x4_t row = vminq_s32(vcvtq_s32_f32(pos), vdupq_n_s32(kSincPhases - 1));
+            int32_t rows[4];
+            float w[4], s[4];
+            vst1q_s32(rows, row);
+            vst1q_f32(w, vsubq_f32(pos, vcvtq_f32_s32(row)));
+            for (int j = 0; j < 4; ++j) {
+                const float* r = sinc_table().rows[rows[j]];
+                const float* x = t + idx[j] - 3;
+                const float32x4_t c0 = vfmaq_n_f32(vld1q_f32(r), vld1q_f32(r + kSincTaps), w[j]);
+                const float32x4_t c1 = vfmaq_n_f32(vld1q_f32(r + 4), vld1q_f32(r + kSincTaps + 4), w[j]);
+                s[j] = vaddvq_f32(vfmaq_f32(vmulq_f32(c0, vld1q_f32(x)), c1, vld1q_f32(x + 4)));
+            }
+            sample = vld1q_f32(s);
+        }
+        vst1q_f32(out + i, vmulq_f32(sample, amp));
+        phase = vaddq_u32(phase, step);
+    }
+    oscillator_scalar_span<Mode>(b, p + static_cast<uint32_t>(i) * inc, out + i, frames - i);
+}
+#endif
+
+struct OscillatorBackend {
+    OscillatorKernel kernels[kNumInterpolations];  // by Interpolation
+    const char* name;
+};
+
+// The four instantiations of a kernel template, in Interpolation order.
+#define OSCAR_KERNELS(kernel) \
+    {kernel<Interpolation::None>, kernel<Interpolation::Linear>, kernel<Interpolation::Hermite>, kernel<Interpolation::Sinc>}
+
+// OSCAR_SIMD=scalar (or sse2, ...) in the environment forces a narrower
+// kernel, which is handy for comparing backends.
+static OscillatorBackend select_oscillator_backend() {
+    const char* forced = std::getenv("OSCAR_SIMD");
+    auto allowed = [forced](const char* name) { return forced == nullptr || std::strcmp(forced, name) == 0; };
+#if defined(OSCAR_SIMD_X86)
+    if (allowed("avx2") && cpu_has_avx2_fma()) return {OSCAR_KERNELS(oscillator_avx2), "avx2"};
+    if (allowed("sse2")) return {OSCAR_KERNELS(oscillator_sse2), "sse2"};
+#elif defined(OSCAR_SIMD_NEON)
+    if (allowed("neon")) return {OSCAR_KERNELS(oscillator_neon), "neon"};
+#endif
+    (void)allowed;
+    return {OSCAR_KERNELS(oscillator_scalar), "scalar"};
+}
+
+#undef OSCAR_KERNELS
+
+static const OscillatorBackend& oscillator_backend() {
+    static const OscillatorBackend backend = select_oscillator_backend();
+    return backend;
+}
+
+std::string simd_backend() { return oscillator_backend().name; }
+
+static OscillatorKernel oscillator_kernel(Interpolation mode) {
+    return oscillator_backend().kernels[static_cast<std::size_t>(mode)];
+}
+
+// The kernel, plus the blend toward the next frame of a wavetable set: out =
+// lower + morph * (upper - lower). Each frame is still one SIMD kernel pass.
+static void oscillate(const OscillatorBlock& b, float* out, unsigned long frames) {
+    const OscillatorKernel kernel = oscillator_kernel(b.interpolation);
+    if (b.next_table == nullptr || b.morph <= 0.f) {
+        kernel(b, out, frames);
+        return;
+    }
+    OscillatorBlock upper = b;
+    upper.table = b.next_table;
+    kernel(upper, out, frames);
+    if (b.morph >= 1.f) return;
+    constexpr unsigned long kChunk = 256;
+    alignas(64) float lower_out[kChunk];
+    OscillatorBlock lower = b;
+    for (unsigned long i = 0; i < frames; i += kChunk) {
+        const unsigned long n = std::min(kChunk, frames - i);
+        kernel(lower, lower_out, n);
+        for (unsigned long k = 0; k < n; ++k) {
+            out[i + k] = lower_out[k] + b.morph * (out[i + k] - lower_out[k]);
+        }
+        lower.phase += lower.increment * static_cast<uint32_t>(n);
+    }
+}
+
+// Renders `from` and blends it into `out`, which already holds the block being
+// faded to: out = from + mix * (out - from), with mix rising by `step` per sample.
+static void crossfade_from(OscillatorBlock from, float* out, unsigned long frames, float mix, float step) {
+    constexpr unsigned long kChunk = 256;
+    alignas(64) float from_out[kChunk];
+    for (unsigned long i = 0; i < frames; i += kChunk) {
+        const unsigned long n = std::min(kChunk, frames - i);
+        oscillate(from, from_out, n);
+        for (unsigned long k = 0; k < n; ++k, mix += step) {
+            out[i + k] = from_out[k] + mix * (out[i + k] - from_out[k]);
+        }
+        from.phase += from.increment * static_cast<uint32_t>(n);
+    }
+}
+
+// Per-sample variant of the oscillator for blocks where frequency, amplitude
+// or phase offset move from sample to sample: the caller supplies each
+// sample's phase and gain.
+template <Interpolation Mode>
+static void oscillator_at_phases(const float* table, unsigned table_bits, const uint32_t* phase, const float* gain,
+                                 float* out, unsigned long frames) {
+    const unsigned shift = 32 - table_bits;
+    const uint32_t frac_mask = (uint32_t{1} << shift) - 1;
+    const float frac_scale = std::ldexp(1.f, -static_cast<int>(shift));
+    for (unsigned long i = 0; i < frames; ++i) {
+        const uint32_t i0 = phase[i] >> shift;
+        const float frac = static_cast<float>(phase[i] & frac_mask) * frac_scale;
+        out[i] = interpolate<Mode>(table, i0, frac) * gain[i];
+    }
+}
+
+// oscillator_at_phases for a wavetable set: each sample also has its own
+// position in the stack, and blends the two frames either side of it.
+// `frame(f)` is frame f's samples at the level being rendered.
+template <Interpolation Mode, typename FrameAt>
+static void oscillator_at_positions(FrameAt frame, unsigned num_frames, unsigned table_bits, const uint32_t* phase,
+                                    const float* gain, const float* position, float* out, unsigned long frames) {
+    const unsigned shift = 32 - table_bits;
+    const uint32_t frac_mask = (uint32_t{1} << shift) - 1;
+    const float frac_scale = std::ldexp(1.f, -static_cast<int>(shift));
+    const float top = static_cast<float>(num_frames - 1);
+    for (unsigned long i = 0; i < frames; ++i) {
+        const float p = std::min(std::max(position[i], 0.f), top);
+        const auto f = static_cast<unsigned>(p);
+        const float w = p - static_cast<float>(f);
+        const uint32_t i0 = phase[i] >> shift;
+        const float frac = static_cast<float>(phase[i] & frac_mask) * frac_scale;
+        const float a = interpolate<Mode>(frame(f), i0, frac);
+        const float b = interpolate<Mode>(frame(std::min(f + 1, num_frames - 1)), i0, frac);
+        out[i] = (a + w * (b - a)) * gain[i];
+    }
+}
+
+// out = from + mix * (out - from), with mix rising by `step` per sample.
+static void blend_from(float* out, const float* from, unsigned long frames, float mix, float step) {
+    for (unsigned long i = 0; i < frames; ++i, mix += step) {
+        out[i] = from[i] + mix * (out[i] - from[i]);
+    }
+}
+
+
+// --- Oversampling ---
+// Synths mixed into an oversampled bus render their oscillators at 2, 4 or 8
+// times the device rate, and a cascade of 2:1 half-band decimators brings
+// them back down. Table mip levels are picked for the higher rate, so sharp
+// shapes keep their harmonics up to near the device's Nyquist instead of
+// losing up to an octave of them.
+//
+// Each stage is a 31-tap Blackman-windowed half-band FIR in polyphase form.
+// Every other tap is zero, so the even input phase only meets the 0.5 centre
+// tap and the odd phase meets 8 symmetric pairs. Splitting the input into
+// the two phases first makes both contiguous, so outputs vectorize directly.
+
+constexpr unsigned kMaxOversampling = 8;
+constexpr unsigned long kOversampleChunk = 256;       // oversampled samples rendered per pass
+constexpr int kHalfbandPairs = 8;                     // taps either side of the centre, on the odd phase
+constexpr int kHalfbandHistory = 4 * kHalfbandPairs - 2;  // input a stage carries between passes
+
+struct HalfbandFilter {
+    float g[kHalfbandPairs];  // tap 2k + 1 either side of the centre
+
+    HalfbandFilter() {
+        double taps[kHalfbandPairs];
+        double sum = 0.0;
+        for (int k = 0; k < kHalfbandPairs; ++k) {
+            const double m = 2.0 * k + 1.0;
+            const double x = m / (2.0 * kHalfbandPairs);  // -1..1 across the filter
+            const double w = 0.42 + 0.5 * std::cos(M_PI * x) + 0.08 * std::cos(2.0 * M_PI * x);
+            taps[k] = std::sin(M_PI * m / 2.0) / (M_PI * m) * w;
+            sum += taps[k];
+        }
+        for (int k = 0; k < kHalfbandPairs; ++k) g[k] = static_cast<float>(taps[k] * 0.25 / sum);  // unity gain at DC
     }
 };
 
+static const HalfbandFilter& halfband_filter() {
+    static const HalfbandFilter filter;
+    return filter;
+}
 
-class Patch : public std::enable_shared_from_this<Patch> {
-private:
-    std::string synth_name_;
-    std::vector<int> channels_;
+// One 2:1 stage. `work` holds kHalfbandHistory samples of history followed
+// by 2 * frames of new input; `out` (frames, at most kOversampleChunk / 2)
+// may alias the input, since the input is split into its phases first.
+inline void halfband_decimate(const float* work, float* out, unsigned long frames) {
+    constexpr unsigned long kMaxPhase = kHalfbandHistory / 2 + kOversampleChunk / 2;
+    alignas(64) float even[kMaxPhase];
+    alignas(64) float odd[kMaxPhase];
+    const unsigned long half = kHalfbandHistory / 2 + frames;
+    unsigned long i = 0;
+#if defined(OSCAR_SIMD_X86)
+    for (; i + 4 <= half; i += 4) {
+        const __m128 a = _mm_loadu_ps(work + 2 * i);
+        const __m128 b = _mm_loadu_ps(work + 2 * i + 4);
+        _mm_store_ps(even + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_store_ps(odd + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+#elif defined(OSCAR_SIMD_NEON)
+    for (; i + 4 <= half; i += 4) {
+        const float32x4x2_t v = vld2q_f32(work + 2 * i);
+        vst1q_f32(even + i, v.val[0]);
+        vst1q_f32(odd + i, v.val[1]);
+    }
+#endif
+    for (; i < half; ++i) {
+        even[i] = work[2 * i];
+        odd[i] = work[2 * i + 1];
+    }
 
-public:
-    Patch(std::string synth_name, std::vector<int> channels) 
-        : synth_name_(std::move(synth_name)), channels_(std::move(channels)) {}
-    ~Patch() = default;
+    // Output n is centred on input 2 * (n + kHalfbandPairs), whose odd
+    // neighbours 2k + 1 away are odd[n + K + k] and odd[n + K - 1 - k].
+    constexpr int K = kHalfbandPairs;
+    const float* g = halfband_filter().g;
+    unsigned long n = 0;
+#if defined(OSCAR_SIMD_X86)
+    const __m128 centre = _mm_set1_ps(0.5f);
+    for (; n + 4 <= frames; n += 4) {
+        __m128 acc = _mm_mul_ps(centre, _mm_loadu_ps(even + n + K));
+        for (int k = 0; k < K; ++k) {
+            const __m128 pair = _mm_add_ps(_mm_loadu_ps(odd + n + K + k), _mm_loadu_ps(odd + n + K - 1 - k));
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(g[k]), pair));
+        }
+        _mm_storeu_ps(out + n, acc);
+    }
+#elif defined(OSCAR_SIMD_NEON)
+    for (; n + 4 <= frames; n += 4) {
+        float32x4_t acc = vmulq_n_f32(vld1q_f32(even + n + K), 0.5f);
+        for (int k = 0; k < K; ++k) {
+            acc = vfmaq_n_f32(acc, vaddq_f32(vld1q_f32(odd + n + K + k), vld1q_f32(odd + n + K - 1 - k)), g[k]);
+        }
+        vst1q_f32(out + n, acc);
+    }
+#endif
+    for (; n < frames; ++n) {
+        float acc = 0.5f * even[n + K];
+        for (int k = 0; k < K; ++k) acc += g[k] * (odd[n + K + k] + odd[n + K - 1 - k]);
+        out[n] = acc;
+    }
+}
 
-    const std::string& get_synth_name() const { return synth_name_; }
-    const std::vector<int>& get_channels() const { return channels_; }
-    void set_synth_name(const std::string& name) { synth_name_ = name; }
-    void set_channels(const std::vector<int>& channels) { channels_ = channels; }
+// The decimation state of one oversampled stream: one stage per octave.
+struct Decimator {
+    unsigned factor{1};
+    float history[3][kHalfbandHistory]{};
+
+    void reset(unsigned new_factor) {
+        factor = new_factor;
+        for (auto& stage : history) std::fill(std::begin(stage), std::end(stage), 0.f);
+    }
+
+    // `work` holds kHalfbandHistory free samples and then frames * factor
+    // oversampled ones (at most kOversampleChunk), and is overwritten; `out`
+    // gets frames at the device rate.
+    void process(float* work, unsigned long frames, float* out) {
+        unsigned long length = frames * factor;
+        for (unsigned stage = 0; length > frames; ++stage) {
+            std::copy(std::begin(history[stage]), std::end(history[stage]), work);
+            std::copy(work + length, work + length + kHalfbandHistory, history[stage]);  // the newest input
+            length /= 2;
+            halfband_decimate(work, length == frames ? out : work + kHalfbandHistory, length);
+        }
+    }
 };
 
 
-class AudioEngine {
-private:
-    PaStream* stream_{nullptr};
-    double sample_rate_;
-    int numOutputChannels_{0};
-    float master_volume{1.f};
-    double master_phase_{0.f};
-    
-    std::map<std::string, std::shared_ptr<Synth>> synths_;
-    std::map<std::string, std::shared_ptr<Patch>> patches_;
-    
-    std::recursive_mutex engine_mutex_;
-    std::vector<std::string> synth_names_to_delete_;
-    std::vector<std::string> patch_names_to_delete_;
+// --- Mix bus kernels ---
+// The engine mixes into a planar bus: one aligned buffer per output channel.
+// Both the bus lanes and the synth slot buffers come from ScratchArena, so
+// every block starts 64-byte aligned.
 
-    void _cleanup() {
-        std::vector<std::string> synth_names_to_process;
-        std::vector<std::string> patch_names_to_process;
-        {
-            std::lock_guard<std::recursive_mutex> lock(engine_mutex_);
-            if (synth_names_to_delete_.empty() && patch_names_to_delete_.empty()) return;
-            
-            synth_names_to_process.swap(synth_names_to_delete_);
-            patch_names_to_process.swap(patch_names_to_delete_);
+// dst[i] += src[i] * gain
+inline void mix_accumulate(float* dst, const float* src, float gain, unsigned long frames) {
+    unsigned long i = 0;
+#if defined(OSCAR_SIMD_X86)
+    const __m128 g = _mm_set1_ps(gain);
+    for (; i + 8 <= frames; i += 8) {
+        _mm_store_ps(dst + i, _mm_add_ps(_mm_load_ps(dst + i), _mm_mul_ps(_mm_load_ps(src + i), g)));
+        _mm_store_ps(dst + i + 4, _mm_add_ps(_mm_load_ps(dst + i + 4), _mm_mul_ps(_mm_load_ps(src + i + 4), g)));
+    }
+#elif defined(OSCAR_SIMD_NEON)
+    const float32x4_t g = vdupq_n_f32(gain);
+    for (; i + 8 <= frames; i += 8) {
+        vst1q_f32(dst + i, vfmaq_f32(vld1q_f32(dst + i), vld1q_f32(src + i), g));
+        vst1q_f32(dst + i + 4, vfmaq_f32(vld1q_f32(dst + i + 4), vld1q_f32(src + i + 4), g));
+    }
+#endif
+    for (; i < frames; ++i) dst[i] += src[i] * gain;
+}
+
+// dst[i] = src[i] * gain, for copying a bus lane out to a host buffer (which
+// may not be aligned).
+inline void copy_with_gain(float* dst, const float* src, float gain, unsigned long frames) {
+    unsigned long i = 0;
+#if defined(OSCAR_SIMD_X86)
+    const __m128 g = _mm_set1_ps(gain);
+    for (; i + 4 <= frames; i += 4) _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_load_ps(src + i), g));
+#elif defined(OSCAR_SIMD_NEON)
+    const float32x4_t g = vdupq_n_f32(gain);
+    for (; i + 4 <= frames; i += 4) vst1q_f32(dst + i, vmulq_f32(vld1q_f32(src + i), g));
+#endif
+    for (; i < frames; ++i) dst[i] = src[i] * gain;
+}
+
+// The one interleave pass per block, applying the master gain on the way.
+inline void interleave_with_gain(float* out, const float* const* lanes, int num_channels, unsigned long frames, float gain) {
+    unsigned long i = 0;
+#if defined(OSCAR_SIMD_X86)
+    if (num_channels == 2) {
+        const __m128 g = _mm_set1_ps(gain);
+        for (; i + 4 <= frames; i += 4) {
+            const __m128 x = _mm_mul_ps(_mm_load_ps(lanes[0] + i), g);
+            const __m128 y = _mm_mul_ps(_mm_load_ps(lanes[1] + i), g);
+            _mm_storeu_ps(out + 2 * i, _mm_unpacklo_ps(x, y));
+            _mm_storeu_ps(out + 2 * i + 4, _mm_unpackhi_ps(x, y));
+        }
+    }
+#elif defined(OSCAR_SIMD_NEON)
+    if (num_channels == 2) {
+        const float32x4_t g = vdupq_n_f32(gain);
+        for (; i + 4 <= frames; i += 4) {
+            float32x4x2_t xy;
+            xy.val[0] = vmulq_f32(vld1q_f32(lanes[0] + i), g);
+            xy.val[1] = vmulq_f32(vld1q_f32(lanes[1] + i), g);
+            vst2q_f32(out + 2 * i, xy);
+        }
+    }
+#endif
+    for (; i < frames; ++i) {
+        for (int c = 0; c < num_channels; ++c) {
+            out[i * num_channels + c] = lanes[c][i] * gain;
+        }
+    }
+}
+
+// A sub-mix bus's X/Y transform, accumulated into its destination lanes:
+//   dst_x += m[0]*x + m[1]*y + m[4],  dst_y += m[2]*x + m[3]*y + m[5]
+// with m moving linearly from `from` to `to` across the block (reaching `to`
+// on the last sample), so gain and matrix changes don't click. x and y are
+// bus lanes (aligned); the destinations are bus or parent lanes (aligned).
+inline void mix_transform(float* dst_x, float* dst_y, const float* x, const float* y, const float* from, const float* to, unsigned long frames) {
+    float m[6], step[6];
+    for (int k = 0; k < 6; ++k) {
+        step[k] = frames > 0 ? (to[k] - from[k]) / static_cast<float>(frames) : 0.f;
+        m[k] = from[k] + step[k];
+    }
+    unsigned long i = 0;
+#if defined(OSCAR_SIMD_X86)
+    const __m128 ramp = _mm_set_ps(3.f, 2.f, 1.f, 0.f);
+    __m128 mv[6], sv[6];
+    for (int k = 0; k < 6; ++k) {
+        sv[k] = _mm_set1_ps(step[k]);
+        mv[k] = _mm_add_ps(_mm_set1_ps(m[k]), _mm_mul_ps(ramp, sv[k]));
+        sv[k] = _mm_mul_ps(sv[k], _mm_set1_ps(4.f));
+    }
+    for (; i + 4 <= frames; i += 4) {
+        const __m128 xv = _mm_load_ps(x + i);
+        const __m128 yv = _mm_load_ps(y + i);
+        const __m128 ox = _mm_add_ps(_mm_add_ps(_mm_mul_ps(mv[0], xv), _mm_mul_ps(mv[1], yv)), mv[4]);
+        const __m128 oy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(mv[2], xv), _mm_mul_ps(mv[3], yv)), mv[5]);
+        _mm_store_ps(dst_x + i, _mm_add_ps(_mm_load_ps(dst_x + i), ox));
+        _mm_store_ps(dst_y + i, _mm_add_ps(_mm_load_ps(dst_y + i), oy));
+        for (int k = 0; k < 6; ++k) mv[k] = _mm_add_ps(mv[k], sv[k]);
+    }
+#elif defined(OSCAR_SIMD_NEON)
+    const float ramp_values[4] = {0.f, 1.f, 2.f, 3.f};
+    const float32x4_t ramp = vld1q_f32(ramp_values);
+    float32x4_t mv[6], sv[6];
+    for (int k = 0; k < 6; ++k) {
+        sv[k] = vdupq_n_f32(step[k]);
+        mv[k] = vfmaq_f32(vdupq_n_f32(m[k]), ramp, sv[k]);
+        sv[k] = vmulq_n_f32(sv[k], 4.f);
+    }
+    for (; i + 4 <= frames; i += 4) {
+        const float32x4_t xv = vld1q_f32(x + i);
+        const float32x4_t yv = vld1q_f32(y + i);
+        const float32x4_t ox = vfmaq_f32(vfmaq_f32(mv[4], mv[0], xv), mv[1], yv);
+        const float32x4_t oy = vfmaq_f32(vfmaq_f32(mv[5], mv[2], xv), mv[3], yv);
+        vst1q_f32(dst_x + i, vaddq_f32(vld1q_f32(dst_x + i), ox));
+        vst1q_f32(dst_y + i, vaddq_f32(vld1q_f32(dst_y + i), oy));
+        for (int k = 0; k < 6; ++k) mv[k] = vaddq_f32(mv[k], sv[k]);
+    }
+#endif
+    for (; i < frames; ++i) {
+        const float t = static_cast<float>(i);
+        float c[6];
+        for (int k = 0; k < 6; ++k) c[k] = m[k] + step[k] * t;
+        dst_x[i] += c[0] * x[i] + c[1] * y[i] + c[4];
+        dst_y[i] += c[2] * x[i] + c[3] * y[i] + c[5];
+    }
+}
+
+// Triangular-PDF dither of +/-1 LSB from a xorshift generator. One per
+// output pass, so no synchronisation.
+struct TpdfDither {
+    uint32_t state = 0x9e3779b9u;
+
+    uint32_t _step() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+    float next() {
+        constexpr float kScale = 1.f / 4294967296.f;
+        return static_cast<float>(_step()) * kScale - static_cast<float>(_step()) * kScale;
+    }
+};
+
+// Writes one bus lane as Bytes-wide little-endian integers, `stride` bytes
+// apart, applying the master gain, clipping to full scale and optionally
+// dithering.
+template <int Bytes>
+inline void quantize_with_gain(uint8_t* out, std::size_t stride, const float* lane, float gain, unsigned long frames, TpdfDither* dither) {
+    constexpr double kFullScale = static_cast<double>((int64_t{1} << (8 * Bytes - 1)) - 1);
+    constexpr long kMin = -static_cast<long>(kFullScale) - 1;
+    constexpr long kMax = static_cast<long>(kFullScale);
+    for (unsigned long i = 0; i < frames; ++i, out += stride) {
+        double x = std::clamp(static_cast<double>(lane[i] * gain), -1.0, 1.0) * kFullScale;
+        if (dither != nullptr) x += dither->next();
+        const auto q = static_cast<uint32_t>(static_cast<int32_t>(std::clamp(std::lrint(x), kMin, kMax)));
+        for (int b = 0; b < Bytes; ++b) out[b] = static_cast<uint8_t>(q >> (8 * b));
+    }
+}
+
+
+// Dense integer id of a synth or patch, assigned by the engine at creation
+// and reused after deletion. The renderer indexes flat arrays with these.
+using Handle = uint32_t;
+constexpr Handle kNoHandle = UINT32_MAX;
+
+
+// --- Control commands ---
+
+// Bounded single-producer/single-consumer ring. The capacity (rounded up to a
+// power of two) is allocated once; pushing and popping never allocate, lock
+// or block.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(std::size_t capacity) {
+        std::size_t size = 1;
+        while (size < capacity) size *= 2;
+        buffer_.resize(size);
+        mask_ = size - 1;
+    }
+
+    std::size_t capacity() const { return buffer_.size(); }
+
+    // Producer side: no room for another push (the consumer can only make room).
+    bool full() const {
+        return tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_acquire) == buffer_.size();
+    }
+
+    // Producer side.
+    bool try_push(const T& item) {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == buffer_.size()) return false;
+        buffer_[tail & mask_] = item;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer side: pushes all `count` items or none. They become visible to
+    // the consumer together.
+    bool try_push_all(const T* items, std::size_t count) {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (buffer_.size() - (tail - head_.load(std::memory_order_acquire)) < count) return false;
+        for (std::size_t i = 0; i < count; ++i) {
+            buffer_[(tail + i) & mask_] = items[i];
         }
+        tail_.store(tail + count, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side.
+    bool try_pop(T& item) {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) return false;
+        item = buffer_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    alignas(64) std::atomic<std::size_t> head_{0};
+    alignas(64) std::atomic<std::size_t> tail_{0};
+    alignas(64) std::vector<T> buffer_;
+    std::size_t mask_{0};
+};
+
+enum class RampShape : uint8_t { Linear, Exponential };
+
+// A parameter change sent from the control side to the audio thread. `time`
+// is the master clock sample it takes effect at; anything earlier than the
+// block being rendered (including 0) lands at the start of that block.
+// Ramps glide from the current value to `value` over `duration` samples.
+struct Command {
+    enum class Type : uint8_t {
+        Start, Stop, SetFrequency, SmoothSetFrequency, SetAmplitude, SetPhaseOffset, SetPosition,
+        RampFrequency, RampAmplitude, RampPhaseOffset, RampPosition,
+        NoteOn, NoteOff, AllNotesOff,  // value is the note number
+    };
+    Type type;
+    Handle synth;
+    uint64_t serial;  // Synth::serial_, so commands for a deleted synth are never
+                      // applied to a new one that reused its handle
+    uint64_t time;
+    uint64_t seq;     // enqueue order, breaks ties between equal times
+    double value;
+    uint64_t duration{0};
+    RampShape shape{RampShape::Linear};
+    float velocity{0.f};  // NoteOn, 0 to 1
+};
 
-        std::lock_guard<std::recursive_mutex> lock(engine_mutex_);
+// A glide toward `target`, advanced once per sample by the audio thread.
+// Exponential ramps need both ends on the same side of zero; otherwise they
+// fall back to linear.
+struct Ramp {
+    double value{0.0};
+    double target{0.0};
+    double step{0.0};  // added per sample, or the per-sample ratio if exponential
+    uint64_t remaining{0};
+    bool exponential{false};
+
+    bool active() const { return remaining > 0; }
+
+    void start(double from, double to, uint64_t samples, RampShape shape) {
+        value = from;
+        target = to;
+        remaining = samples;
+        exponential = shape == RampShape::Exponential && from * to > 0.0;
+        if (samples == 0) {
+            value = to;
+        } else if (exponential) {
+            step = std::pow(to / from, 1.0 / static_cast<double>(samples));
+        } else {
+            step = (to - from) / static_cast<double>(samples);
+        }
+    }
+
+    // Value for the next sample; lands exactly on the target at the end.
+    double next() {
+        if (remaining == 0) return value;
+        value = --remaining == 0 ? target : (exponential ? value * step : value + step);
+        return value;
+    }
+};
+
+
+// A linear ADSR envelope, advanced per sample by the audio thread. Times
+// are in samples; a zero-length stage is skipped. Attack starts from the
+// current level, so a retriggered or stolen voice doesn't click to zero.
+struct Envelope {
+    enum class Stage : uint8_t { Idle, Attack, Decay, Sustain, Release };
+    Stage stage{Stage::Idle};
+    float level{0.f};
+    float step{0.f};
+    float decay_step{0.f};
+    float sustain{1.f};
+
+    bool active() const { return stage != Stage::Idle; }
+
+    void trigger(float attack, float decay, float sustain_level) {
+        sustain = sustain_level;
+        decay_step = decay > 0.f ? (sustain_level - 1.f) / decay : -1.f;
+        stage = Stage::Attack;
+        step = attack > 0.f ? (1.f - level) / attack : 1.f;
+    }
+
+    void release(float samples) {
+        if (stage == Stage::Idle || stage == Stage::Release) return;
+        stage = Stage::Release;
+        step = samples > 0.f ? -level / samples : -1.f;
+        if (level <= 0.f) stage = Stage::Idle;
+    }
+
+    float next() {
+        switch (stage) {
+        case Stage::Idle: return 0.f;
+        case Stage::Attack:
+            level += step;
+            if (level >= 1.f) { level = 1.f; stage = Stage::Decay; step = decay_step; }
+            break;
+        case Stage::Decay:
+            level += step;
+            if (level <= sustain) { level = sustain; stage = Stage::Sustain; }
+            break;
+        case Stage::Sustain: break;
+        case Stage::Release:
+            level += step;
+            if (level <= 0.f) { level = 0.f; stage = Stage::Idle; }
+            break;
+        }
+        return level;
+    }
+};
+
+// One note of a polyphonic synth.
+struct Voice {
+    Envelope envelope;
+    double note{0.0};
+    float velocity{0.f};
+    uint32_t phase{0};   // 0.32, without the synth's phase offset
+    uint64_t order{0};   // note-on order, for stealing the oldest
+};
+
+
+// Parameters one synth's output can modulate on another.
+enum class ModParam : uint8_t { Frequency, Amplitude, PhaseOffset };
+constexpr std::size_t kNumModParams = 3;
+
+// Audio-rate modulation for one render call: per-sample amounts added to
+// frequency (Hz), amplitude and phase offset (cycles); null when unused.
+struct ModInputs {
+    const float* param[kNumModParams]{nullptr, nullptr, nullptr};
+
+    bool any() const { return param[0] || param[1] || param[2]; }
+    const float* at(ModParam p, unsigned long offset) const {
+        const float* in = param[static_cast<std::size_t>(p)];
+        return in ? in + offset : nullptr;
+    }
+};
+
+
+class AudioEngine;
+
+// How a synth finds its phase for each block.
+//  Absolute:    phase = master clock * frequency + offset, recomputed every
+//               block. Synths with equal settings are always phase-locked, but
+//               a frequency change jumps the phase (see smooth_set_frequency).
+//  Accumulator: a 0.64 fixed-point phase is carried from block to block, so
+//               frequency changes are always continuous. Every resync interval
+//               the phase is slewed back toward the absolute phase, keeping
+//               X/Y pairs locked to the master clock without audible jumps.
+enum class PhaseMode { Absolute, Accumulator };
+
+
+// In-place iterative radix-2 FFT; the size must be a power of two. The
+// inverse is unscaled.
+static void fft(std::vector<std::complex<double>>& a, bool inverse) {
+    const std::size_t n = a.size();
+    for (std::size_t i = 1, j = 0; i < n; ++i) {
+        std::size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(a[i], a[j]);
+    }
+    for (std::size_t len = 2; len <= n; len <<= 1) {
+        const double angle = 2.0 * M_PI / static_cast<double>(len) * (inverse ? 1.0 : -1.0);
+        const std::complex<double> w_len(std::cos(angle), std::sin(angle));
+        for (std::size_t i = 0; i < n; i += len) {
+            std::complex<double> w(1.0);
+            for (std::size_t k = 0; k < len / 2; ++k, w *= w_len) {
+                const std::complex<double> u = a[i + k];
+                const std::complex<double> v = a[i + k + len / 2] * w;
+                a[i + k] = u + v;
+                a[i + k + len / 2] = u - v;
+            }
+        }
+    }
+}
+
+// A prepared wavetable. It is never modified once built: updates build a new
+// one off the audio thread and swap the pointer, and the old one is freed by
+// the engine's reaper once the audio thread has let go of it.
+//
+// Level 0 is the table as given. Each further level keeps half the harmonics
+// of the one before (cut in the frequency domain), down to the fundamental,
+// so the renderer can pick a level with nothing above Nyquist. Every level
+// has the full table length, so the per-sample cost doesn't change.
+//
+// A table can also be a stack of `frames` equal-length frames (a wavetable
+// set), which the synth's position parameter morphs between.
+struct Wavetable {
+    // The only copy of the source data: straight into the aligned storage.
+    // `data` holds `num_frames` frames of `size` samples, back to back.
+    Wavetable(const float* data, std::size_t size, std::size_t num_frames = 1)
+        : bits(wavetable_bits(size)), levels(bits), frames(static_cast<unsigned>(std::max<std::size_t>(num_frames, 1))) {
+        storage.allocate(static_cast<std::size_t>(levels) * frames, kTableLead + (std::size_t{1} << bits) + kTableGuard);
+        for (unsigned f = 0; f < frames; ++f) {
+            _build_frame(num_frames > 0 ? data + f * size : data, num_frames > 0 ? size : 0, f);
+        }
+    }
+
+    // A copy with the mip levels already built, so no FFTs are redone.
+    Wavetable(const Wavetable& other) : bits(other.bits), levels(other.levels), frames(other.frames) {
+        const std::size_t length = kTableLead + (std::size_t{1} << bits) + kTableGuard;
+        storage.allocate(static_cast<std::size_t>(levels) * frames, length);
+        for (std::size_t lane = 0; lane < storage.num_lanes(); ++lane) {
+            std::copy_n(other.storage.lane(lane), length, storage.lane(lane));
+        }
+    }
+
+    // Same size and frames, and the same samples as given (every other
+    // level is derived from those).
+    bool same_source(const Wavetable& other) const {
+        if (bits != other.bits || frames != other.frames) return false;
+        for (unsigned f = 0; f < frames; ++f) {
+            if (!std::equal(samples(0, f), samples(0, f) + (std::size_t{1} << bits), other.samples(0, f))) return false;
+        }
+        return true;
+    }
+
+    const float* samples(unsigned level = 0, unsigned frame = 0) const { return _lane(level, frame); }
+
+    // Frame `position` (clamped to the stack) as the frame below it, the one
+    // above and the weight of the one above.
+    void frames_at(unsigned level, double position, const float*& lower, const float*& upper, float& weight) const {
+        const double top = static_cast<double>(frames - 1);
+        const double p = std::min(std::max(position, 0.0), top);
+        const auto f = static_cast<unsigned>(p);
+        lower = samples(level, f);
+        upper = samples(level, std::min(f + 1, frames - 1));
+        weight = static_cast<float>(p - f);
+    }
+
+    // Highest harmonic left in `level` (level 0 keeps everything up to size / 2).
+    std::size_t max_harmonic(unsigned level) const { return (std::size_t{1} << bits) >> (level + 1); }
+
+    // Lowest level whose harmonics all stay below Nyquist at `freq`.
+    unsigned level_for(double freq, double sample_rate) const {
+        const double limit = sample_rate / (2.0 * std::abs(freq));
+        unsigned level = 0;
+        while (level + 1 < levels && static_cast<double>(max_harmonic(level)) > limit) ++level;
+        return level;
+    }
+
+    unsigned bits;
+    unsigned levels;
+    unsigned frames;
+    ScratchArena storage;  // one lane per level, frame by frame, each table kTableLead in
+
+private:
+    float* _lane(unsigned level, unsigned frame) const { return storage.lane(frame * levels + level) + kTableLead; }
+
+    void _build_frame(const float* data, std::size_t size, unsigned frame) {
+        const std::size_t table_size = std::size_t{1} << bits;
+        float* base = _lane(0, frame);
+        prepare_wavetable(data, size, bits, base);
+        if (levels == 1) return;
+
+        std::vector<std::complex<double>> spectrum(base, base + table_size);
+        fft(spectrum, false);
+        std::vector<std::complex<double>> band(table_size);
+        for (unsigned level = 1; level < levels; ++level) {
+            const std::size_t harmonics = max_harmonic(level);
+            std::fill(band.begin(), band.end(), std::complex<double>(0.0));
+            band[0] = spectrum[0];
+            for (std::size_t h = 1; h <= harmonics; ++h) {
+                band[h] = spectrum[h];
+                band[table_size - h] = spectrum[table_size - h];
+            }
+            fft(band, true);
+            float* out = _lane(level, frame);
+            for (std::size_t i = 0; i < table_size; ++i) {
+                out[i] = static_cast<float>(band[i].real() / static_cast<double>(table_size));
+            }
+            wrap_table_guards(out, table_size);
+        }
+    }
+};
+
+// Tables arrive from Python as float32 NumPy arrays. forcecast and c_style
+// make pybind11 hand over the caller's buffer as-is when it already is one,
+// and only convert otherwise.
+using TableArray = py::array_t<float, py::array::c_style | py::array::forcecast>;
+
+// Builds a table from a NumPy array without holding the GIL during the copy.
+// A 2-D (frames, samples) array is a wavetable set.
+inline std::unique_ptr<const Wavetable> make_wavetable(const TableArray& table) {
+    if (table.ndim() > 2) throw std::runtime_error("A wavetable must be a 1-D table or a 2-D (frames, samples) stack.");
+    const float* data = table.data();
+    const auto num_frames = table.ndim() == 2 ? static_cast<std::size_t>(table.shape(0)) : 1;
+    const auto size = table.ndim() == 2 ? static_cast<std::size_t>(table.shape(1)) : static_cast<std::size_t>(table.size());
+    py::gil_scoped_release release;
+    return std::make_unique<const Wavetable>(data, size, num_frames);
+}
+
+
+// --- Table generators ---
+// Engine-side versions of the tables Python would otherwise build with NumPy
+// on every regen. They run on the caller's thread with the GIL released and
+// produce a power-of-two length directly, so the Wavetable doesn't resample.
+
+enum class WaveShape { Sine, Saw, Square, Triangle };
+
+// XY paths arrive as (points, 2) float32 arrays.
+using PathArray = py::array_t<float, py::array::c_style | py::array::forcecast>;
+
+inline std::size_t generated_size(std::size_t size) {
+    return std::size_t{1} << wavetable_bits(size);
+}
+
+// Scales the table so its peak is 1, as Synth.regen does; silence is left alone.
+inline void normalize_table(std::vector<float>& table) {
+    float peak = 0.f;
+    for (float v : table) peak = std::max(peak, std::abs(v));
+    if (peak == 0.f) return;
+    const float scale = 1.f / peak;
+    for (float& v : table) v *= scale;
+}
+
+// The same shapes as Synth.WAVES, sample for sample.
+inline std::vector<float> generate_wave(WaveShape shape, std::size_t size) {
+    const std::size_t n = generated_size(size);
+    std::vector<float> table(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        const double t = static_cast<double>(i) / static_cast<double>(n);
+        switch (shape) {
+        case WaveShape::Sine: table[i] = static_cast<float>(std::sin(2.0 * M_PI * t)); break;
+        case WaveShape::Saw: table[i] = static_cast<float>(2.0 * t - 1.0); break;
+        case WaveShape::Square: {
+            const double s = std::sin(2.0 * M_PI * t);
+            table[i] = static_cast<float>((s > 0.0) - (s < 0.0));
+            break;
+        }
+        case WaveShape::Triangle: table[i] = static_cast<float>(1.0 - 2.0 * std::abs(2.0 * t - 1.0)); break;
+        }
+    }
+    return table;
+}
+
+// Sum of sines: harmonic h + 1 at amplitudes[h] and phases[h] (in cycles,
+// 0 if not given). Built as one inverse FFT of the spectrum; harmonics at or
+// above half the table length are dropped.
+inline std::vector<float> generate_partials(std::size_t size, const std::vector<double>& amplitudes, const std::vector<double>& phases) {
+    const std::size_t n = std::max<std::size_t>(generated_size(size), 4);
+    std::vector<std::complex<double>> spectrum(n);
+    for (std::size_t h = 0; h < amplitudes.size() && h + 1 < n / 2; ++h) {
+        const double phase = h < phases.size() ? 2.0 * M_PI * phases[h] : 0.0;
+        // a * sin(w + phase) = Im(a * e^(i(w + phase))), split across +/-(h + 1).
+        const std::complex<double> bin = std::polar(0.5 * amplitudes[h] * static_cast<double>(n), phase) * std::complex<double>(0.0, -1.0);
+        spectrum[h + 1] = bin;
+        spectrum[n - h - 1] = std::conj(bin);
+    }
+    fft(spectrum, true);
+    std::vector<float> table(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        table[i] = static_cast<float>(spectrum[i].real() / static_cast<double>(n));
+    }
+    return table;
+}
+
+// One coordinate (`axis` 0 = X, 1 = Y) of a polyline traced at constant
+// speed, so a pair of synths on X and Y draws the shape with even
+// brightness. A closed path returns to its first point.
+inline std::vector<float> generate_path(std::size_t size, const float* points, std::size_t num_points, int axis, bool closed) {
+    const std::size_t n = generated_size(size);
+    std::vector<float> table(n, 0.f);
+    if (num_points == 0) return table;
+    const std::size_t num_segments = closed ? num_points : num_points - 1;
+    std::vector<double> length(num_segments + 1, 0.0);
+    for (std::size_t s = 0; s < num_segments; ++s) {
+        const float* p = points + 2 * s;
+        const float* q = points + 2 * ((s + 1) % num_points);
+        length[s + 1] = length[s] + std::hypot(q[0] - p[0], q[1] - p[1]);
+    }
+    const double total = length[num_segments];
+    if (total == 0.0) {
+        std::fill(table.begin(), table.end(), points[axis]);
+        return table;
+    }
+    // An open path ends on its last point; a closed one wraps onto the first.
+    const double step = total / static_cast<double>(closed ? n : n - 1);
+    std::size_t s = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        const double at = std::min(step * static_cast<double>(i), total);
+        while (s + 1 < num_segments && length[s + 1] < at) ++s;
+        const double span = length[s + 1] - length[s];
+        const double frac = span > 0.0 ? (at - length[s]) / span : 0.0;
+        const float a = points[2 * s + axis];
+        const float b = points[2 * ((s + 1) % num_points) + axis];
+        table[i] = static_cast<float>(a + frac * (b - a));
+    }
+    return table;
+}
+
+// (1 - t) * a + t * b, with both tables resampled to `size` first.
+inline std::vector<float> morph_tables(const float* a, std::size_t size_a, const float* b, std::size_t size_b, double t, std::size_t size) {
+    const unsigned bits = wavetable_bits(size);
+    const std::size_t n = std::size_t{1} << bits;
+    std::vector<float> from(kTableLead + n + kTableGuard), to(kTableLead + n + kTableGuard);
+    prepare_wavetable(a, size_a, bits, from.data() + kTableLead);
+    prepare_wavetable(b, size_b, bits, to.data() + kTableLead);
+    const auto w = static_cast<float>(t);
+    std::vector<float> table(n);
+    for (std::size_t i = 0; i < n; ++i) table[i] = from[kTableLead + i] + w * (to[kTableLead + i] - from[kTableLead + i]);
+    return table;
+}
+
+// A generated shape as a NumPy array, for creating a synth with.
+inline py::array_t<float> wave_table(WaveShape shape, std::size_t size) {
+    std::vector<float> table = generate_wave(shape, size);
+    py::array_t<float> out(std::vector<py::ssize_t>{static_cast<py::ssize_t>(table.size())});
+    std::copy(table.begin(), table.end(), out.mutable_data());
+    return out;
+}
+
+
+class Synth : public std::enable_shared_from_this<Synth> {
+private:
+    friend class AudioEngine;
+
+    Handle handle_{kNoHandle};
+    uint64_t serial_{0};  // unique for the engine's lifetime, unlike the handle
+    // Owning engine, whose command queue the setters post to. Cleared by the
+    // engine when the synth is deleted; a detached synth applies changes directly.
+    AudioEngine* engine_{nullptr};
+
+    // Written by the audio thread as commands are applied.
+    std::atomic<bool> is_playing_{false};
+    std::atomic<double> phase_offset_{0.f};
+    double sample_rate_;
+    std::atomic<double> amplitude_{0.5f};
+    std::atomic<double> frequency_{440.f};
+    // Running glides, audio thread only. While any is active the synth
+    // renders through the per-sample path (_render_ramped).
+    Ramp frequency_ramp_;
+    Ramp amplitude_ramp_;
+    Ramp phase_offset_ramp_;
+    // Position in a wavetable set, in frames (0 is the first frame);
+    // fractional positions blend the neighbouring frames.
+    std::atomic<double> position_{0.0};
+    Ramp position_ramp_;
+    std::atomic<unsigned> num_frames_{1};
+
+    // Polyphonic synths: a voice pool allocated with the synth and never
+    // resized, so notes only ever touch preallocated state. Voices are
+    // audio thread only; the envelope settings (seconds, and the sustain
+    // level) are read at each note-on or note-off.
+    std::unique_ptr<Voice[]> voices_;
+    unsigned num_voices_{0};
+    uint64_t next_voice_order_{0};
+    std::atomic<unsigned> active_voices_{0};
+    std::atomic<float> attack_{0.005f};
+    std::atomic<float> decay_{0.1f};
+    std::atomic<float> sustain_{0.8f};
+    std::atomic<float> release_{0.2f};
+
+    // Table hand-off. The control side publishes into pending_table_; the audio
+    // thread takes it at the start of a render, optionally crossfading from the
+    // table it replaces, and pushes tables it is done with to retired_tables_
+    // for the reaper. table_ and fade_from_ are only touched by the audio thread.
+    static constexpr std::size_t kRetiredTableCapacity = 32;
+    const Wavetable* table_;
+    const Wavetable* fade_from_{nullptr};
+    unsigned long fade_length_{0};
+    unsigned long fade_remaining_{0};
+    std::atomic<const Wavetable*> pending_table_{nullptr};
+    std::atomic<unsigned long> pending_fade_{0};
+    // The table installed last, for scene snapshots. table_mutex_ keeps it
+    // from being replaced (and so freed) while it is copied.
+    mutable std::mutex table_mutex_;
+    const Wavetable* latest_table_;
+    // Mip level of table_ rendered last block (audio thread), or kNoLevel
+    // after a table change; a level change is crossfaded over one block.
+    static constexpr unsigned kNoLevel = ~0u;
+    unsigned level_{kNoLevel};
+    std::atomic<bool> band_limited_{true};
+    std::atomic<Interpolation> interpolation_{Interpolation::Linear};
+    // Audio thread: the oversampling factor rendered at (set by the render
+    // graph each block) and the filter state bringing it back down.
+    Decimator decimator_;
+    SpscRing<const Wavetable*> retired_tables_{kRetiredTableCapacity};
+    std::atomic<PhaseMode> phase_mode_{PhaseMode::Absolute};
+    std::atomic<uint64_t> resync_interval_{0};  // samples, 0 = free running
+
+    // Accumulator state, only touched by the audio thread.
+    bool accum_valid_{false};
+    uint64_t accum_start_{0};    // master clock sample of the last rendered block
+    unsigned long accum_frames_{0};
+    uint64_t accum_phase_{0};    // phase at accum_start_, without the offset
+    uint64_t accum_step_{0};     // per-sample step used for that block
+    int64_t slew_{0};            // per-sample correction toward the master clock
+    uint64_t since_resync_{0};
+
+    // Advances the accumulator to the block starting at `start` and returns the
+    // per-sample step to render it with.
+    uint64_t _advance_accumulator(uint64_t start, unsigned long frames, double freq) {
+        // Rendering the same block again (for another patch) must not advance it.
+        if (accum_valid_ && start == accum_start_) return accum_step_;
+
+        const double cycles_per_sample = freq / this->sample_rate_;
+        if (!accum_valid_ || start != accum_start_ + accum_frames_) {
+            // No continuous history to follow: lock straight onto the master clock.
+            accum_phase_ = to_fixed_phase64(static_cast<double>(start) * cycles_per_sample);
+            slew_ = 0;
+            since_resync_ = 0;
+        } else {
+            accum_phase_ += accum_step_ * accum_frames_;
+        }
+
+        const uint64_t interval = resync_interval_.load();
+        if (interval > 0 && since_resync_ >= interval) {
+            // Spread the error over the next interval; the signed difference is
+            // always the shorter way round the cycle.
+            const uint64_t target = to_fixed_phase64(static_cast<double>(start) * cycles_per_sample);
+            slew_ = static_cast<int64_t>(target - accum_phase_) / static_cast<int64_t>(interval);
+            since_resync_ = 0;
+        }
+
+        accum_valid_ = true;
+        accum_start_ = start;
+        accum_frames_ = frames;
+        accum_step_ = to_fixed_phase64(cycles_per_sample) + static_cast<uint64_t>(slew_);
+        since_resync_ += frames;
+        return accum_step_;
+    }
+
+public:
+    // With `voices` > 0 the synth is polyphonic: it plays notes (see
+    // note_on) rather than a single oscillator.
+    Synth(double sample_rate, std::unique_ptr<const Wavetable> table, unsigned voices = 0) : 
+        sample_rate_(sample_rate),
+        num_frames_(table->frames),
+        voices_(voices > 0 ? std::make_unique<Voice[]>(voices) : nullptr),
+        num_voices_(voices),
+        table_(table.release()),
+        latest_table_(table_)
+    {   
+        //setFrequency(this->frequency_);
+        resync_interval_.store(static_cast<uint64_t>(sample_rate));
+    }
+    // Only runs once no render graph holds the synth, so nothing can be
+    // reading its tables.
+    virtual ~Synth() {
+        delete table_;
+        delete fade_from_;
+        delete pending_table_.load();
+        const Wavetable* retired;
+        while (retired_tables_.try_pop(retired)) delete retired;
+    }
+
+    Synth(const Synth&) = delete;
+    Synth& operator=(const Synth&) = delete;
+
+    // `oversampling` (1, 2, 4 or 8) renders the oscillators at that multiple
+    // of the sample rate and decimates back down into `mono_out`.
+    void render(float* mono_out, unsigned long frames, double master_phase_start, const ModInputs* mod = nullptr, unsigned oversampling = 1) {
+        _acquire_table();
+        if (decimator_.factor != oversampling) decimator_.reset(oversampling);
+        if (voices_) {
+            _render_voices(mono_out, frames);
+            return;
+        }
+        static const ModInputs kNoModulation;
+        if (frequency_ramp_.active() || amplitude_ramp_.active() || phase_offset_ramp_.active() || position_ramp_.active() || (mod && mod->any())) {
+            _render_per_sample(mono_out, frames, static_cast<uint64_t>(master_phase_start), mod ? *mod : kNoModulation);
+            return;
+        }
+
+        // The phase is only worked out once per block; the kernel then steps a
+        // fixed-point phase accumulator from there.
+        const double freq = frequency_.load();
+        const unsigned os = oversampling;
+        const double rate = this->sample_rate_ * os;
+        uint32_t phase, increment;
+        if (phase_mode_.load() == PhaseMode::Accumulator) {
+            const uint64_t step = _advance_accumulator(static_cast<uint64_t>(master_phase_start), frames, freq);
+            phase = static_cast<uint32_t>((accum_phase_ + to_fixed_phase64(phase_offset_.load())) >> 32);
+            increment = static_cast<uint32_t>((step / os + (uint64_t{1} << 31)) >> 32);
+        } else {
+            accum_valid_ = false;
+            const double cycles = (master_phase_start * freq) / this->sample_rate_ + phase_offset_.load();
+            phase = to_fixed_phase(cycles);
+            increment = to_fixed_phase(freq / rate);
+        }
+        const unsigned level = band_limited_.load() ? table_->level_for(freq, rate) : 0;
+        const double position = position_.load();
+        OscillatorBlock block{
+            table_->samples(level),
+            table_->bits,
+            phase,
+            increment,
+            static_cast<float>(amplitude_.load()),
+        };
+        block.interpolation = interpolation_.load();
+        table_->frames_at(level, position, block.table, block.next_table, block.morph);
+        if (os > 1) {
+            _render_oversampled(block, level, position, mono_out, frames);
+            return;
+        }
+        oscillate(block, mono_out, frames);
+        if (level_ != level && level_ != kNoLevel) {
+            OscillatorBlock previous = block;
+            table_->frames_at(level_, position, previous.table, previous.next_table, previous.morph);
+            crossfade_from(previous, mono_out, frames, 0.f, 1.f / static_cast<float>(frames));
+        }
+        level_ = level;
+        if (fade_from_ != nullptr) _render_fade(block, mono_out, frames);
+    }
+
+    // The block-rate path at decimator_.factor times the sample rate, a chunk
+    // of oscillator output at a time.
+    void _render_oversampled(OscillatorBlock block, unsigned level, double position, float* out, unsigned long frames) {
+        const unsigned os = decimator_.factor;
+        alignas(64) float work[kHalfbandHistory + kOversampleChunk];
+        float* hi = work + kHalfbandHistory;
+        const bool level_change = level_ != level && level_ != kNoLevel;
+        OscillatorBlock previous = block;
+        if (level_change) table_->frames_at(level_, position, previous.table, previous.next_table, previous.morph);
+        const float level_step = 1.f / static_cast<float>(frames * os);
+        const unsigned long chunk = kOversampleChunk / os;
+        for (unsigned long i = 0; i < frames; i += chunk) {
+            const unsigned long n = std::min(chunk, frames - i);
+            const auto m = static_cast<uint32_t>(n * os);
+            oscillate(block, hi, m);
+            if (level_change) {
+                crossfade_from(previous, hi, m, static_cast<float>(i * os) * level_step, level_step);
+                previous.phase += previous.increment * m;
+            }
+            if (fade_from_ != nullptr) _render_fade(block, hi, n, os);
+            block.phase += block.increment * m;
+            decimator_.process(work, n, out + i);
+        }
+        level_ = level;
+    }
+
+    Handle handle() const { return handle_; }
+    // The setters queue the change for the audio thread, which applies it at
+    // master clock sample `at` (0 means at the start of the next block). The
+    // getters report the value currently being rendered.
+    void start(uint64_t at = 0);
+    void stop(uint64_t at = 0);
+    bool is_playing() const { return is_playing_.load(); }
+    void set_frequency(double freq, uint64_t at = 0);
+    double get_frequency() const { return frequency_; }
+    void set_amplitude(double amp, uint64_t at = 0);
+    double get_amplitude() const { return amplitude_; }
+    // Builds the new table on the calling thread and hands it to the audio
+    // thread, which crossfades to it over `crossfade` samples (0 switches at
+    // the next block). A table published before the previous one was picked
+    // up replaces it.
+    void update_wavetable(const TableArray& new_table, unsigned long crossfade = 0) {
+        install_wavetable(make_wavetable(new_table), crossfade);
+    }
+    void install_wavetable(std::unique_ptr<const Wavetable> table, unsigned long crossfade = 0) {
+        std::lock_guard<std::mutex> lock(table_mutex_);
+        latest_table_ = table.get();
+        num_frames_.store(table->frames, std::memory_order_relaxed);
+        pending_fade_.store(crossfade, std::memory_order_relaxed);
+        delete pending_table_.exchange(table.release(), std::memory_order_acq_rel);
+    }
+    // Table generators (see generate_wave and friends), installed like
+    // update_wavetable. The GIL is released while the table is built.
+    void generate_wave(WaveShape shape, std::size_t size, unsigned long crossfade = 0) {
+        py::gil_scoped_release release;
+        _install_generated(::generate_wave(shape, size), crossfade);
+    }
+    void generate_partials(const std::vector<double>& amplitudes, const std::vector<double>& phases, std::size_t size, bool normalize = true, unsigned long crossfade = 0) {
+        py::gil_scoped_release release;
+        std::vector<float> table = ::generate_partials(size, amplitudes, phases);
+        if (normalize) normalize_table(table);
+        _install_generated(table, crossfade);
+    }
+    void generate_path(const PathArray& points, int axis, bool closed, std::size_t size, unsigned long crossfade = 0) {
+        if (points.ndim() != 2 || points.shape(1) != 2) {
+            throw std::runtime_error("Path points must be a (points, 2) array of X/Y pairs.");
+        }
+        if (axis != 0 && axis != 1) {
+            throw std::runtime_error("Path axis must be 0 (X) or 1 (Y).");
+        }
+        const float* data = points.data();
+        const auto num_points = static_cast<std::size_t>(points.shape(0));
+        py::gil_scoped_release release;
+        _install_generated(::generate_path(size, data, num_points, axis, closed), crossfade);
+    }
+    void morph_wavetables(const TableArray& from, const TableArray& to, double t, std::size_t size, bool normalize = true, unsigned long crossfade = 0) {
+        const float* a = from.data();
+        const float* b = to.data();
+        const auto size_a = static_cast<std::size_t>(from.size());
+        const auto size_b = static_cast<std::size_t>(to.size());
+        py::gil_scoped_release release;
+        std::vector<float> table = morph_tables(a, size_a, b, size_b, t, size);
+        if (normalize) normalize_table(table);
+        _install_generated(table, crossfade);
+    }
+    void set_phase_offset(double offset, uint64_t at = 0);
+    double get_phase_offset() const { return phase_offset_.load(); }
+    void set_phase_mode(PhaseMode mode) { phase_mode_.store(mode); }
+    PhaseMode get_phase_mode() const { return phase_mode_.load(); }
+    // Renders from the band-limited mip levels (the default) or always from the table as given.
+    void set_band_limited(bool enabled) { band_limited_.store(enabled); }
+    bool get_band_limited() const { return band_limited_.load(); }
+    void set_interpolation(Interpolation mode) { interpolation_.store(mode); }
+    Interpolation get_interpolation() const { return interpolation_.load(); }
+    // Seconds between accumulator re-syncs to the master clock; 0 never re-syncs.
+    void set_resync_interval(double seconds) {
+        resync_interval_.store(static_cast<uint64_t>(std::max(0.0, seconds) * sample_rate_));
+    }
+    double get_resync_interval() const { return static_cast<double>(resync_interval_.load()) / sample_rate_; }
+    // Changes frequency while keeping the absolute phase continuous at `at`.
+    void smooth_set_frequency(double new_freq, uint64_t at = 0);
+    // Glides from the current value to `target` over `samples` samples,
+    // starting at `at`; evaluated per sample by the engine. A set or a new
+    // ramp on the same parameter replaces a running one. Frequency glides keep
+    // the phase continuous, like smooth_set_frequency.
+    void ramp_frequency(double target, uint64_t samples, RampShape shape = RampShape::Linear, uint64_t at = 0);
+    void ramp_amplitude(double target, uint64_t samples, RampShape shape = RampShape::Linear, uint64_t at = 0);
+    void ramp_phase_offset(double target, uint64_t samples, uint64_t at = 0);
+    // Wavetable sets: which frame to play, blending between neighbouring
+    // frames at fractional positions (per sample while gliding).
+    void set_position(double position, uint64_t at = 0);
+    double get_position() const { return position_.load(); }
+    void ramp_position(double target, uint64_t samples, uint64_t at = 0);
+    // Frames in the most recently installed table (1 for a plain table).
+    unsigned get_num_frames() const { return num_frames_.load(); }
+    // Polyphonic synths. A note plays at frequency * 2^((note - 69) / 12), so
+    // the synth's frequency is the tuning of A4. Velocity is 0 to 1, scaled
+    // by the amplitude. A new note takes a free voice, or retriggers the
+    // voice already playing that note, or steals the oldest (released
+    // voices first).
+    void note_on(double note, float velocity = 1.f, uint64_t at = 0);
+    void note_off(double note, uint64_t at = 0);
+    void all_notes_off(uint64_t at = 0);
+    void set_envelope(float attack, float decay, float sustain, float release) {
+        attack_.store(std::max(0.f, attack));
+        decay_.store(std::max(0.f, decay));
+        sustain_.store(std::min(std::max(sustain, 0.f), 1.f));
+        release_.store(std::max(0.f, release));
+    }
+    std::tuple<float, float, float, float> get_envelope() const { return {attack_.load(), decay_.load(), sustain_.load(), release_.load()}; }
+    unsigned get_polyphony() const { return num_voices_; }
+    // Voices sounding at the end of the last block (including releases).
+    unsigned get_active_voices() const { return active_voices_.load(); }
+
+private:
+    void _post(Command::Type type, double value, uint64_t at, uint64_t duration = 0, RampShape shape = RampShape::Linear, float velocity = 0.f);
+    void _require_voices(const char* action) const;
+
+    // Audio thread: every sounding voice, each through the block kernel with
+    // its own increment and mip level, scaled by its envelope. Frequency,
+    // amplitude, phase offset and position are taken once per block; glides
+    // and modulation only apply to single-oscillator synths.
+    void _render_voices(float* out, unsigned long frames) {
+        // There is no per-voice crossfade state, so a faded table switch is immediate.
+        if (fade_from_ != nullptr && retired_tables_.try_push(fade_from_)) fade_from_ = nullptr;
+        std::fill_n(out, frames, 0.f);
+        const double tuning = frequency_.load();
+        const auto amplitude = static_cast<float>(amplitude_.load());
+        const double position = position_.load();
+        const uint32_t offset = to_fixed_phase(phase_offset_.load());
+        const bool band_limited = band_limited_.load();
+        const Interpolation interpolation = interpolation_.load();
+        const unsigned os = decimator_.factor;
+        const double rate = this->sample_rate_ * os;
+
+        // Oversampled voices are summed at the higher rate and decimated once.
+        constexpr unsigned long kChunk = kOversampleChunk;
+        alignas(64) float voice_out[kChunk];
+        alignas(64) float work[kHalfbandHistory + kChunk];
+        const unsigned long chunk = kChunk / os;
+        for (unsigned long i = 0; i < frames; i += chunk) {
+            const unsigned long n = std::min(chunk, frames - i);
+            const auto m = static_cast<uint32_t>(n * os);
+            float* mix = os > 1 ? work + kHalfbandHistory : out + i;
+            if (os > 1) std::fill_n(mix, m, 0.f);
+            for (unsigned v = 0; v < num_voices_; ++v) {
+                Voice& voice = voices_[v];
+                if (!voice.envelope.active()) continue;
+                const double freq = tuning * std::exp2((voice.note - 69.0) / 12.0);
+                const unsigned level = band_limited ? table_->level_for(freq, rate) : 0;
+                OscillatorBlock block{table_->samples(level), table_->bits, voice.phase + offset, to_fixed_phase(freq / rate), 1.f};
+                block.interpolation = interpolation;
+                table_->frames_at(level, position, block.table, block.next_table, block.morph);
+                oscillate(block, voice_out, m);
+                const float gain = amplitude * voice.velocity;
+                for (unsigned long k = 0; k < n; ++k) {
+                    const float envelope = voice.envelope.next();
+                    for (unsigned j = 0; j < os; ++j) mix[k * os + j] += voice_out[k * os + j] * gain * envelope;
+                }
+                voice.phase += block.increment * m;
+            }
+            if (os > 1) decimator_.process(work, n, out + i);
+        }
+        unsigned active = 0;
+        for (unsigned v = 0; v < num_voices_; ++v) {
+            if (voices_[v].envelope.active()) ++active;
+        }
+        active_voices_.store(active, std::memory_order_relaxed);
+    }
+
+    // Audio thread: the voice for a new note.
+    Voice& _allocate_voice(double note) {
+        Voice* free_voice = nullptr;
+        Voice* oldest = &voices_[0];
+        for (unsigned v = 0; v < num_voices_; ++v) {
+            Voice& voice = voices_[v];
+            if (!voice.envelope.active()) {
+                if (free_voice == nullptr) free_voice = &voice;
+                continue;
+            }
+            if (voice.note == note) return voice;
+            const bool released = voice.envelope.stage == Envelope::Stage::Release;
+            const bool oldest_released = oldest->envelope.stage == Envelope::Stage::Release;
+            if (!oldest->envelope.active() || (released && !oldest_released) || (released == oldest_released && voice.order < oldest->order)) {
+                oldest = &voice;
+            }
+        }
+        if (free_voice != nullptr) {
+            free_voice->phase = 0;
+            return *free_voice;
+        }
+        return *oldest;
+    }
+
+    void _install_generated(const std::vector<float>& table, unsigned long crossfade) {
+        install_wavetable(std::make_unique<const Wavetable>(table.data(), table.size()), crossfade);
+    }
+
+    // Audio thread: the per-sample path, used while any ramp is running or
+    // another synth modulates this one. The phase is integrated sample by
+    // sample from the ramped and modulated frequency, and handed back to the
+    // block-rate state at the end so the fast path carries on from exactly
+    // where this left off.
+    void _render_per_sample(float* out, unsigned long frames, uint64_t start, const ModInputs& mod) {
+        const double inv_rate = 1.0 / this->sample_rate_;
+        const bool accumulate = phase_mode_.load() == PhaseMode::Accumulator;
+        const float* freq_mod = mod.at(ModParam::Frequency, 0);
+        const float* amp_mod = mod.at(ModParam::Amplitude, 0);
+        const float* phase_mod = mod.at(ModParam::PhaseOffset, 0);
+        const bool gliding = frequency_ramp_.active() || freq_mod != nullptr;
+        double freq = frequency_.load();
+        double amp = amplitude_.load();
+        double offset = phase_offset_.load();
+        double position = position_.load();
+
+        uint64_t phase;  // 0.64, without the offset
+        const bool continuous = accumulate && accum_valid_ && start == accum_start_ + accum_frames_;
+        if (continuous) {
+            phase = accum_phase_ + accum_step_ * accum_frames_;
+        } else {
+            phase = to_fixed_phase64(static_cast<double>(start) * freq * inv_rate);
+            slew_ = 0;
+            since_resync_ = 0;
+        }
+        uint64_t step = to_fixed_phase64(freq * inv_rate);
+        uint64_t offset_fixed = to_fixed_phase64(offset);
+
+        // One mip level for the whole block, safe for its highest frequency.
+        double top = std::max(std::abs(freq), frequency_ramp_.active() ? std::abs(frequency_ramp_.target) : 0.0);
+        if (freq_mod != nullptr) {
+            float deviation = 0.f;
+            for (unsigned long i = 0; i < frames; ++i) deviation = std::max(deviation, std::abs(freq_mod[i]));
+            top += deviation;
+        }
+        // Oversampled, each sample's phase is stepped through `os` points and
+        // its gain and position held across them.
+        const unsigned os = decimator_.factor;
+        const unsigned level = band_limited_.load() ? table_->level_for(top, this->sample_rate_ * os) : 0;
+        const Interpolation interpolation = interpolation_.load();
+        const bool level_change = level_ != kNoLevel && level_ != level;
+
+        constexpr unsigned long kChunk = kOversampleChunk;
+        alignas(64) uint32_t phases[kChunk];
+        alignas(64) uint32_t steps[kChunk];
+        alignas(64) float gains[kChunk];
+        alignas(64) float positions[kChunk];
+        alignas(64) float other[kChunk];
+        alignas(64) float work[kHalfbandHistory + kChunk];
+        const unsigned long chunk = kChunk / os;
+        for (unsigned long i = 0; i < frames; i += chunk) {
+            const unsigned long n = std::min(chunk, frames - i);
+            for (unsigned long k = 0; k < n; ++k) {
+                if (frequency_ramp_.active()) {
+                    freq = frequency_ramp_.next();
+                    step = to_fixed_phase64(freq * inv_rate);
+                }
+                if (amplitude_ramp_.active()) amp = amplitude_ramp_.next();
+                if (phase_offset_ramp_.active()) {
+                    offset = phase_offset_ramp_.next();
+                    offset_fixed = to_fixed_phase64(offset);
+                }
+                if (position_ramp_.active()) position = position_ramp_.next();
+                positions[k] = static_cast<float>(position);
+                const uint64_t phase_shift = phase_mod ? to_fixed_phase64(phase_mod[i + k]) : 0;
+                phases[k] = static_cast<uint32_t>((phase + offset_fixed + phase_shift) >> 32);
+                gains[k] = static_cast<float>(amp_mod ? amp + amp_mod[i + k] : amp);
+                const uint64_t sample_step = freq_mod ? to_fixed_phase64((freq + freq_mod[i + k]) * inv_rate) : step;
+                const uint64_t advance = sample_step + (accumulate ? static_cast<uint64_t>(slew_) : 0);
+                steps[k] = static_cast<uint32_t>(advance >> 32);
+                phase += advance;
+            }
+            if (os > 1) {
+                // Back to front, so every sample is read before it is overwritten.
+                for (unsigned long k = n; k-- > 0;) {
+                    const uint32_t p = phases[k], d = steps[k] / os;
+                    const float g = gains[k], pos = positions[k];
+                    for (unsigned j = os; j-- > 0;) {
+                        phases[k * os + j] = p + j * d;
+                        gains[k * os + j] = g;
+                        positions[k * os + j] = pos;
+                    }
+                }
+            }
+            const unsigned long m = n * os;
+            float* dst = os > 1 ? work + kHalfbandHistory : out + i;
+            _oscillate_at(interpolation, *table_, level, phases, gains, positions, dst, m);
+            if (level_change) {
+                _oscillate_at(interpolation, *table_, level_, phases, gains, positions, other, m);
+                const float level_step = 1.f / static_cast<float>(frames * os);
+                blend_from(dst, other, m, static_cast<float>(i * os) * level_step, level_step);
+            }
+            if (fade_from_ != nullptr && fade_remaining_ > 0) {
+                const unsigned long faded = std::min(n, fade_remaining_);
+                const unsigned old_level = std::min(level, fade_from_->levels - 1);
+                _oscillate_at(interpolation, *fade_from_, old_level, phases, gains, positions, other, faded * os);
+                const float fade_step = 1.f / static_cast<float>(fade_length_ * os);
+                blend_from(dst, other, faded * os, static_cast<float>((fade_length_ - fade_remaining_) * os) * fade_step, fade_step);
+                fade_remaining_ -= faded;
+            }
+            if (os > 1) decimator_.process(work, n, out + i);
+        }
+        level_ = level;
+        if (fade_from_ != nullptr && fade_remaining_ == 0 && retired_tables_.try_push(fade_from_)) {
+            fade_from_ = nullptr;
+        }
+
+        if (accumulate) {
+            accum_valid_ = true;
+            accum_start_ = start;
+            accum_frames_ = frames;
+            accum_step_ = step + static_cast<uint64_t>(slew_);
+            accum_phase_ = phase - accum_step_ * frames;
+            since_resync_ += frames;
+        } else {
+            accum_valid_ = false;
+            if (gliding) {
+                // Fold what the glide gained over the absolute phase into the
+                // offset, so the block-rate path picks up the same phase.
+                const uint64_t absolute = to_fixed_phase64(static_cast<double>(start + frames) * freq * inv_rate);
+                const double drift = std::ldexp(static_cast<double>(static_cast<int64_t>(phase - absolute)), -64);
+                offset += drift;
+                phase_offset_ramp_.value += drift;
+                phase_offset_ramp_.target += drift;
+                offset -= std::floor(offset);
+            }
+        }
+        frequency_.store(freq);
+        amplitude_.store(amp);
+        phase_offset_.store(offset);
+        position_.store(position);
+    }
+
+    template <Interpolation Mode>
+    static void _oscillate_at(const Wavetable& table, unsigned level, const uint32_t* phases, const float* gains,
+                              const float* positions, float* out, unsigned long frames) {
+        if (table.frames == 1) {
+            oscillator_at_phases<Mode>(table.samples(level), table.bits, phases, gains, out, frames);
+            return;
+        }
+        oscillator_at_positions<Mode>([&](unsigned f) { return table.samples(level, f); }, table.frames, table.bits,
+                                      phases, gains, positions, out, frames);
+    }
+
+    static void _oscillate_at(Interpolation mode, const Wavetable& table, unsigned level, const uint32_t* phases,
+                              const float* gains, const float* positions, float* out, unsigned long frames) {
+        switch (mode) {
+            case Interpolation::None: _oscillate_at<Interpolation::None>(table, level, phases, gains, positions, out, frames); break;
+            case Interpolation::Linear: _oscillate_at<Interpolation::Linear>(table, level, phases, gains, positions, out, frames); break;
+            case Interpolation::Hermite: _oscillate_at<Interpolation::Hermite>(table, level, phases, gains, positions, out, frames); break;
+            case Interpolation::Sinc: _oscillate_at<Interpolation::Sinc>(table, level, phases, gains, positions, out, frames); break;
+        }
+    }
+
+    // Audio thread: switches to a newly published table. Waits while a
+    // crossfade is still running, or while the reaper is behind, so a table
+    // is never dropped while it might still be read.
+    void _acquire_table() {
+        if (fade_from_ != nullptr || retired_tables_.full()) return;
+        if (pending_table_.load(std::memory_order_relaxed) == nullptr) return;
+        const Wavetable* next = pending_table_.exchange(nullptr, std::memory_order_acq_rel);
+        const unsigned long fade = pending_fade_.load(std::memory_order_relaxed);
+        if (fade > 0) {
+            fade_from_ = table_;
+            fade_length_ = fade_remaining_ = fade;
+        } else {
+            retired_tables_.try_push(table_);
+        }
+        table_ = next;
+        level_ = kNoLevel;
+    }
+
+    // Audio thread: blends the outgoing table into `out`, which already holds
+    // the block rendered from the new one, and retires it when the fade ends.
+    // Oversampled, `out` holds frames * os samples.
+    void _render_fade(const OscillatorBlock& block, float* out, unsigned long frames, unsigned os = 1) {
+        const unsigned long n = std::min(frames, fade_remaining_);
+        if (n > 0) {
+            OscillatorBlock old_block = block;
+            const unsigned level = band_limited_.load() ? fade_from_->level_for(frequency_.load(), this->sample_rate_ * os) : 0;
+            fade_from_->frames_at(level, position_.load(), old_block.table, old_block.next_table, old_block.morph);
+            old_block.table_bits = fade_from_->bits;
+            const float step = 1.f / static_cast<float>(fade_length_ * os);
+            crossfade_from(old_block, out, n * os, static_cast<float>((fade_length_ - fade_remaining_) * os) * step, step);
+            fade_remaining_ -= n;
+        }
+        if (fade_remaining_ == 0 && retired_tables_.try_push(fade_from_)) {
+            fade_from_ = nullptr;
+        }
+    }
+
+    // Reaper (under the engine's control lock): collects the tables the audio
+    // thread has finished with.
+    void _take_retired_tables(std::vector<const Wavetable*>& out) {
+        const Wavetable* retired;
+        while (retired_tables_.try_pop(retired)) out.push_back(retired);
+    }
+
+    // A copy of the table installed last, mip levels included.
+    std::unique_ptr<const Wavetable> _copy_table() const {
+        std::lock_guard<std::mutex> lock(table_mutex_);
+        return std::make_unique<const Wavetable>(*latest_table_);
+    }
+
+    // Audio thread (or a detached synth): applies a command that takes effect
+    // at master clock sample `time`.
+    void _apply(const Command& command, uint64_t time) {
+        const double value = command.value;
+        switch (command.type) {
+        case Command::Type::Start: is_playing_.store(true); break;
+        case Command::Type::Stop: is_playing_.store(false); break;
+        case Command::Type::SetFrequency: frequency_ramp_.remaining = 0; frequency_.store(value); break;
+        case Command::Type::SetAmplitude: amplitude_ramp_.remaining = 0; amplitude_.store(value); break;
+        case Command::Type::SetPhaseOffset: phase_offset_ramp_.remaining = 0; phase_offset_.store(value); break;
+        case Command::Type::SetPosition: position_ramp_.remaining = 0; position_.store(value); break;
+        case Command::Type::SmoothSetFrequency:
+            frequency_ramp_.remaining = 0;
+            _apply_smooth_frequency(value, time);
+            break;
+        case Command::Type::RampFrequency:
+            frequency_ramp_.start(frequency_.load(), value, command.duration, command.shape);
+            if (!frequency_ramp_.active()) _apply_smooth_frequency(value, time);
+            break;
+        case Command::Type::RampAmplitude:
+            amplitude_ramp_.start(amplitude_.load(), value, command.duration, command.shape);
+            if (!amplitude_ramp_.active()) amplitude_.store(value);
+            break;
+        case Command::Type::RampPhaseOffset:
+            phase_offset_ramp_.start(phase_offset_.load(), value, command.duration, RampShape::Linear);
+            if (!phase_offset_ramp_.active()) phase_offset_.store(value);
+            break;
+        case Command::Type::RampPosition:
+            position_ramp_.start(position_.load(), value, command.duration, RampShape::Linear);
+            if (!position_ramp_.active()) position_.store(value);
+            break;
+        case Command::Type::NoteOn: {
+            if (!voices_) break;
+            Voice& voice = _allocate_voice(value);
+            voice.note = value;
+            voice.velocity = command.velocity;
+            voice.order = next_voice_order_++;
+            voice.envelope.trigger(attack_.load() * static_cast<float>(sample_rate_), decay_.load() * static_cast<float>(sample_rate_), sustain_.load());
+            break;
+        }
+        case Command::Type::NoteOff:
+        case Command::Type::AllNotesOff:
+            for (unsigned v = 0; v < num_voices_; ++v) {
+                if (command.type == Command::Type::AllNotesOff || voices_[v].note == value) {
+                    voices_[v].envelope.release(release_.load() * static_cast<float>(sample_rate_));
+                }
+            }
+            break;
+        }
+    }
+
+    void _apply_smooth_frequency(double new_freq, uint64_t time) {
+        const double old_freq = frequency_.load();
+        const double old_phase_offset = phase_offset_.load();
+
+        const double time_at_change = static_cast<double>(time) / sample_rate_;
+
+        // Calculate the necessary phase shift: p_new = p_old + t * (f_old - f_new)
+        const double phase_correction = time_at_change * (old_freq - new_freq);
+        double new_phase_offset = old_phase_offset + phase_correction;
+
+        // Wrap the phase offset to the [0.0, 1.0) range
+        new_phase_offset = fmod(new_phase_offset, 1.0);
+        if (new_phase_offset < 0.0) {
+            new_phase_offset += 1.0;
+        }
+
+        frequency_.store(new_freq);
+        phase_offset_.store(new_phase_offset);
+    }
+};
+
+
+class Patch : public std::enable_shared_from_this<Patch> {
+private:
+    friend class AudioEngine;
+
+    Handle handle_{kNoHandle};
+    // Resolved once when the patch is (re)targeted; the name is only kept for
+    // the Python side.
+    Handle synth_handle_{kNoHandle};
+    std::string synth_name_;
+    std::vector<int> channels_;
+    // With a bus, channels_ index the bus's lanes (0 = X, 1 = Y) rather than
+    // device channels.
+    Handle bus_handle_{kNoHandle};
+    std::string bus_name_;
+    // Owning engine, so edits from Python can republish the render graph.
+    // Cleared by the engine when the patch is deleted.
+    AudioEngine* engine_{nullptr};
+
+public:
+    Patch(std::string synth_name, std::vector<int> channels) 
+        : synth_name_(std::move(synth_name)), channels_(std::move(channels)) {}
+    ~Patch() = default;
+
+    Handle handle() const { return handle_; }
+    Handle synth_handle() const { return synth_handle_; }
+    const std::string& get_synth_name() const { return synth_name_; }
+    const std::vector<int>& get_channels() const { return channels_; }
+    const std::string& get_bus_name() const { return bus_name_; }
+    void set_synth_name(const std::string& name);
+    void set_channels(const std::vector<int>& channels);
+    void set_bus(const std::string& name);
+};
+
+
+// A stereo (X/Y) sub-mix. Patches route into its two lanes instead of device
+// channels, and the bus mixes the sum onward, to its parent bus or to two
+// device channels, through out = gain * M * in + t. Animating a whole
+// figure is then one bus update rather than one per synth.
+class Bus : public std::enable_shared_from_this<Bus> {
+private:
+    friend class AudioEngine;
+
+    Handle handle_{kNoHandle};
+    // Routing is graph state, changed under the engine's control lock.
+    std::string parent_name_;
+    Handle parent_handle_{kNoHandle};
+    std::vector<int> channels_;
+    unsigned oversampling_{1};
+    AudioEngine* engine_{nullptr};
+
+    // The transform is changed from Python without republishing the graph.
+    // Writers take write_mutex_ and bump seq_ around the update; the audio
+    // thread retries a torn read a few times, then keeps the previous block's
+    // coefficients.
+    enum { kGain, kA, kB, kC, kD, kTx, kTy, kNumParams };
+    std::mutex write_mutex_;
+    std::atomic<uint32_t> seq_{0};
+    std::atomic<float> params_[kNumParams];
+
+    // Audio thread only: the coefficients the last block ended on.
+    float applied_[6]{};
+    bool has_applied_{false};
+
+    void _write(int first, std::initializer_list<float> values) {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        seq_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        int k = first;
+        for (float v : values) params_[k++].store(v, std::memory_order_relaxed);
+        seq_.fetch_add(1, std::memory_order_release);
+    }
+
+    float _read(int k) const { return params_[k].load(std::memory_order_relaxed); }
+
+    // Audio thread: this block's starting and ending coefficients, as
+    // {gain*a, gain*b, gain*c, gain*d, tx, ty}.
+    void _take_transform(float* from, float* to) {
+        for (int attempt = 0; attempt < 4; ++attempt) {
+            const uint32_t seq = seq_.load(std::memory_order_acquire);
+            if (seq & 1u) continue;
+            float p[kNumParams];
+            for (int k = 0; k < kNumParams; ++k) p[k] = _read(k);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) != seq) continue;
+            const float next[6] = {p[kGain] * p[kA], p[kGain] * p[kB], p[kGain] * p[kC], p[kGain] * p[kD], p[kTx], p[kTy]};
+            // A new bus starts on its transform rather than ramping in from zero.
+            std::copy(next, next + 6, to);
+            if (!has_applied_) std::copy(next, next + 6, applied_);
+            std::copy(applied_, applied_ + 6, from);
+            std::copy(next, next + 6, applied_);
+            has_applied_ = true;
+            return;
+        }
+        std::copy(applied_, applied_ + 6, from);
+        std::copy(applied_, applied_ + 6, to);
+    }
+
+public:
+    explicit Bus(std::vector<int> channels) : channels_(std::move(channels)) {
+        const float identity[kNumParams] = {1.f, 1.f, 0.f, 0.f, 1.f, 0.f, 0.f};
+        for (int k = 0; k < kNumParams; ++k) params_[k].store(identity[k], std::memory_order_relaxed);
+    }
+
+    Handle handle() const { return handle_; }
+    const std::string& get_parent() const { return parent_name_; }
+    const std::vector<int>& get_channels() const { return channels_; }
+    void set_parent(const std::string& name);
+    void set_channels(const std::vector<int>& channels);
+    // Synths patched into the bus (or a bus under it) render at `factor`
+    // (1, 2, 4 or 8) times the sample rate and are decimated back down.
+    void set_oversampling(unsigned factor);
+    unsigned get_oversampling() const { return oversampling_; }
+
+    void set_gain(float gain) { _write(kGain, {gain}); }
+    float get_gain() const { return _read(kGain); }
+    // Row-major 2x2: x' = a*x + b*y, y' = c*x + d*y.
+    void set_matrix(float a, float b, float c, float d) { _write(kA, {a, b, c, d}); }
+    std::tuple<float, float, float, float> get_matrix() const { return {_read(kA), _read(kB), _read(kC), _read(kD)}; }
+    void set_translate(float tx, float ty) { _write(kTx, {tx, ty}); }
+    std::tuple<float, float> get_translate() const { return {_read(kTx), _read(kTy)}; }
+    void set_transform(float gain, float a, float b, float c, float d, float tx, float ty) { _write(kGain, {gain, a, b, c, d, tx, ty}); }
+};
+
+
+// --- Parallel render workers ---
+
+inline void cpu_relax() {
+#if defined(OSCAR_SIMD_X86)
+    _mm_pause();
+#elif defined(OSCAR_SIMD_NEON) && defined(_MSC_VER)
+    __yield();
+#elif defined(OSCAR_SIMD_NEON)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// Best effort: real-time priority and a dedicated core. Without the necessary
+// privileges (e.g. no rtprio limit on Linux) the thread just runs normally.
+static void configure_render_thread(unsigned index) {
+    const unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+    const unsigned core = (index + 1) % cpus;  // leave core 0 to the audio callback
+#if defined(__linux__)
+    sched_param param{};
+    param.sched_priority = std::max(sched_get_priority_min(SCHED_FIFO), sched_get_priority_max(SCHED_FIFO) - 10);
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#elif defined(__APPLE__)
+    (void)core;  // macOS has no hard affinity
+    pthread_set_qos_class_self_np(QOS_CLASS_USER_INTERACTIVE, 0);
+#elif defined(_WIN32)
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+    SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{1} << core);
+#else
+    (void)core;
+#endif
+}
+
+// Lock-free record of audio callback timings. The audio thread is the only
+// writer; stats() readers may see a callback's counters half-updated, which
+// only ever skews a snapshot by one callback.
+//
+// Render times go into a log-linear histogram with 8 buckets per power of
+// two of microseconds (exact below 16 us, within 12.5% above), so
+// percentiles cost nothing on the audio thread.
+class CallbackStats {
+public:
+    static constexpr unsigned kSubBuckets = 8;
+    static constexpr unsigned kBuckets = kSubBuckets * 26;  // up to 2^28 us
+
+    void record(uint64_t micros, uint64_t budget_micros, PaStreamCallbackFlags flags) {
+        buckets_[_bucket(micros)].fetch_add(1, std::memory_order_relaxed);
+        callbacks_.fetch_add(1, std::memory_order_relaxed);
+        total_micros_.fetch_add(micros, std::memory_order_relaxed);
+        if (micros > max_micros_.load(std::memory_order_relaxed)) max_micros_.store(micros, std::memory_order_relaxed);
+        if (micros > budget_micros) overruns_.fetch_add(1, std::memory_order_relaxed);
+        budget_micros_.store(budget_micros, std::memory_order_relaxed);
+        if (flags & paOutputUnderflow) underflows_.fetch_add(1, std::memory_order_relaxed);
+        if (flags & paOutputOverflow) overflows_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Upper bound, in microseconds, of the bucket holding the q-th quantile.
+    uint64_t percentile(double q) const {
+        uint64_t counts[kBuckets];
+        uint64_t total = 0;
+        for (unsigned b = 0; b < kBuckets; ++b) total += counts[b] = buckets_[b].load(std::memory_order_relaxed);
+        if (total == 0) return 0;
+        const auto rank = static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(total)));
+        uint64_t seen = 0;
+        for (unsigned b = 0; b < kBuckets; ++b) {
+            seen += counts[b];
+            if (seen >= std::max<uint64_t>(rank, 1)) return _upper_bound(b);
+        }
+        return _upper_bound(kBuckets - 1);
+    }
+
+    uint64_t callbacks() const { return callbacks_.load(std::memory_order_relaxed); }
+    uint64_t total_micros() const { return total_micros_.load(std::memory_order_relaxed); }
+    uint64_t max_micros() const { return max_micros_.load(std::memory_order_relaxed); }
+    uint64_t budget_micros() const { return budget_micros_.load(std::memory_order_relaxed); }
+    uint64_t overruns() const { return overruns_.load(std::memory_order_relaxed); }
+    uint64_t underflows() const { return underflows_.load(std::memory_order_relaxed); }
+    uint64_t overflows() const { return overflows_.load(std::memory_order_relaxed); }
+
+    void reset() {
+        for (auto& bucket : buckets_) bucket.store(0, std::memory_order_relaxed);
+        for (auto* counter : {&callbacks_, &total_micros_, &max_micros_, &overruns_, &underflows_, &overflows_}) {
+            counter->store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    std::atomic<uint64_t> buckets_[kBuckets]{};
+    std::atomic<uint64_t> callbacks_{0};
+    std::atomic<uint64_t> total_micros_{0};
+    std::atomic<uint64_t> max_micros_{0};
+    std::atomic<uint64_t> budget_micros_{0};
+    std::atomic<uint64_t> overruns_{0};
+    std::atomic<uint64_t> underflows_{0};
+    std::atomic<uint64_t> overflows_{0};
+
+    static unsigned _bucket(uint64_t micros) {
+        if (micros < 2 * kSubBuckets) return static_cast<unsigned>(micros);
+        unsigned shift = 0;
+        while ((micros >> shift) >= 2 * kSubBuckets) ++shift;
+        const unsigned bucket = (shift + 1) * kSubBuckets + static_cast<unsigned>((micros >> shift) - kSubBuckets);
+        return std::min(bucket, kBuckets - 1);
+    }
+
+    static uint64_t _upper_bound(unsigned bucket) {
+        if (bucket < 2 * kSubBuckets) return bucket;
+        const unsigned shift = bucket / kSubBuckets - 1;
+        return ((uint64_t{kSubBuckets} + bucket % kSubBuckets + 1) << shift) - 1;
+    }
+};
+
+
+// Fixed pool of render threads. The audio callback publishes a batch by
+// storing (num_jobs << 32 | 0) into claim_ and bumping generation_; workers,
+// and the callback itself, then take job indices with fetch_add on claim_.
+// Nothing in dispatch blocks, and a worker that wakes up late finds the batch
+// already claimed and simply goes back to waiting.
+class RenderWorkerPool {
+public:
+    using JobFn = void (*)(void* context, uint32_t job);
+
+    explicit RenderWorkerPool(unsigned num_threads) {
+        for (unsigned i = 0; i < num_threads; ++i) {
+            threads_.emplace_back(&RenderWorkerPool::_worker_loop, this, i);
+        }
+    }
+
+    ~RenderWorkerPool() {
+        running_.store(false);
+        for (auto& thread : threads_) thread.join();
+    }
+
+    RenderWorkerPool(const RenderWorkerPool&) = delete;
+    RenderWorkerPool& operator=(const RenderWorkerPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(threads_.size()); }
+
+    // Audio thread: runs jobs [0, num_jobs) on the pool and the calling thread
+    // and returns once all of them are done. Returns false if that took past
+    // `deadline`. Workers stop claiming jobs at the deadline, so everything
+    // still unclaimed then is rendered by the caller; a job a worker has
+    // already started cannot be taken back, so the caller still waits for it.
+    bool run(JobFn fn, void* context, uint32_t num_jobs, std::chrono::steady_clock::time_point deadline) {
+        fn_ = fn;
+        context_ = context;
+        deadline_.store(deadline.time_since_epoch().count(), std::memory_order_relaxed);
+        done_.store(0, std::memory_order_relaxed);
+        claim_.store(static_cast<uint64_t>(num_jobs) << 32, std::memory_order_release);
+        generation_.fetch_add(1, std::memory_order_release);
+
+        _drain(false);
+        while (done_.load(std::memory_order_acquire) < num_jobs) {
+            cpu_relax();
+        }
+        return std::chrono::steady_clock::now() <= deadline;
+    }
+
+private:
+    // fn_ and context_ are written before the release store to claim_ and only
+    // read by whoever wins a valid job index from it.
+    JobFn fn_{nullptr};
+    void* context_{nullptr};
+    // Read before claiming, possibly by a worker still leaving the last batch,
+    // which at worst makes it take one job more or less.
+    std::atomic<std::chrono::steady_clock::rep> deadline_{0};
+    std::atomic<uint64_t> claim_{0};
+    std::atomic<uint32_t> done_{0};
+    std::atomic<uint64_t> generation_{0};
+    std::atomic<bool> running_{true};
+    std::vector<std::thread> threads_;
+
+    void _drain(bool worker) {
+        for (;;) {
+            if (worker && std::chrono::steady_clock::now().time_since_epoch().count() > deadline_.load(std::memory_order_relaxed)) return;
+            const uint64_t claim = claim_.fetch_add(1, std::memory_order_acq_rel);
+            const auto job = static_cast<uint32_t>(claim);
+            if (job >= static_cast<uint32_t>(claim >> 32)) return;
+            fn_(context_, job);
+            done_.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    void _worker_loop(unsigned index) {
+        configure_render_thread(index);
+        uint64_t seen = generation_.load(std::memory_order_acquire);
+        unsigned idle = 0;
+        while (running_.load(std::memory_order_relaxed)) {
+            const uint64_t generation = generation_.load(std::memory_order_acquire);
+            if (generation != seen) {
+                seen = generation;
+                idle = 0;
+                _drain(true);
+                continue;
+            }
+            // Spin through the gap between callbacks, then back off so an idle
+            // engine doesn't burn whole cores. A sleeping worker only costs
+            // parallelism: the callback renders whatever is left itself.
+            if (++idle < 20000) {
+                cpu_relax();
+            } else if (idle < 40000) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        }
+    }
+};
+
+
+// Streams interleaved float32 frames to a file, either headerless or as an
+// IEEE-float WAV whose sizes are patched in by finish().
+class AudioFileWriter {
+public:
+    AudioFileWriter(const std::string& path, bool wav, unsigned channels, double sample_rate)
+        : file_(std::fopen(path.c_str(), "wb")), wav_(wav), channels_(channels), sample_rate_(sample_rate) {
+        if (file_ == nullptr) throw std::runtime_error("Cannot open '" + path + "' for writing.");
+        if (wav_) _write_header();
+    }
+    ~AudioFileWriter() {
+        if (file_ != nullptr) std::fclose(file_);
+    }
+
+    AudioFileWriter(const AudioFileWriter&) = delete;
+    AudioFileWriter& operator=(const AudioFileWriter&) = delete;
+
+    void write(const float* frames, std::size_t count) {
+        if (std::fwrite(frames, sizeof(float) * channels_, count, file_) != count) {
+            throw std::runtime_error("Failed writing audio file.");
+        }
+        frames_written_ += count;
+    }
+
+    void finish() {
+        if (wav_) {
+            std::fseek(file_, 0, SEEK_SET);
+            _write_header();
+        }
+        const bool ok = std::fclose(file_) == 0;
+        file_ = nullptr;
+        if (!ok) throw std::runtime_error("Failed writing audio file.");
+    }
+
+private:
+    std::FILE* file_;
+    bool wav_;
+    unsigned channels_;
+    double sample_rate_;
+    uint64_t frames_written_{0};
+
+    void _put(uint32_t value, int bytes) {
+        for (int i = 0; i < bytes; ++i) std::fputc(static_cast<int>((value >> (8 * i)) & 0xff), file_);
+    }
+
+    void _write_header() {
+        const auto data_bytes = static_cast<uint32_t>(std::min<uint64_t>(frames_written_ * channels_ * sizeof(float), UINT32_MAX - 36));
+        const auto rate = static_cast<uint32_t>(std::lround(sample_rate_));
+        std::fwrite("RIFF", 1, 4, file_);
+        _put(36 + data_bytes, 4);
+        std::fwrite("WAVEfmt ", 1, 8, file_);
+        _put(16, 4);
+        _put(3, 2);  // WAVE_FORMAT_IEEE_FLOAT
+        _put(channels_, 2);
+        _put(rate, 4);
+        _put(rate * channels_ * 4, 4);
+        _put(channels_ * 4, 2);
+        _put(32, 2);
+        std::fwrite("data", 1, 4, file_);
+        _put(data_bytes, 4);
+    }
+};
+
+
+// The final mix, published into a named shared-memory ring (POSIX shm, or a
+// Windows file mapping in the Local\ namespace) for other processes such
+// as the renderer to read without a loopback audio device.
+//
+// Layout: a Header, then kBlockSlots BlockInfo records, then `capacity`
+// interleaved float32 frames. Frame n lives at index n % capacity.
+//  - The writer bumps reserved_frames before overwriting any samples and
+//    committed_frames (release) once they are written. A reader that loads
+//    committed_frames (acquire), copies frames [a, b), then fences and loads
+//    reserved_frames got untorn data iff reserved_frames - capacity <= a.
+//  - Each block also gets a BlockInfo, guarded by its own seqlock counter
+//    (odd while being written), carrying its first frame index, master clock
+//    sample, length, PortAudio DAC time and a steady-clock timestamp.
+class SharedOutputTap {
+public:
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kBlockSlots = 64;
+
+    struct Header {
+        char magic[8];               // "OSCARTAP"
+        uint32_t version;
+        uint32_t channels;
+        uint64_t capacity;           // frames, a power of two
+        double sample_rate;
+        uint32_t block_slots;
+        uint32_t samples_offset;     // bytes from the start of the mapping
+        std::atomic<uint64_t> reserved_frames;
+        std::atomic<uint64_t> committed_frames;
+        std::atomic<uint64_t> blocks;  // total published; the latest is in slot (blocks - 1) % block_slots
+    };
+    struct BlockInfo {
+        std::atomic<uint64_t> seq;
+        uint64_t first_frame;
+        uint64_t sample_time;
+        uint64_t frames;
+        double dac_time;             // PortAudio stream time, 0 offline
+        int64_t monotonic_ns;        // steady clock when published
+    };
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory counters must be lock-free");
+
+    SharedOutputTap(const std::string& name, int channels, uint64_t capacity, double sample_rate)
+        : name_(name), channels_(channels) {
+        const std::size_t samples_offset = (sizeof(Header) + kBlockSlots * sizeof(BlockInfo) + 63) & ~std::size_t{63};
+        bytes_ = samples_offset + static_cast<std::size_t>(capacity) * channels * sizeof(float);
+        _map();
+        header_ = new (map_) Header{};
+        std::memcpy(header_->magic, "OSCARTAP", 8);
+        header_->channels = static_cast<uint32_t>(channels);
+        header_->capacity = capacity;
+        header_->sample_rate = sample_rate;
+        header_->block_slots = kBlockSlots;
+        header_->samples_offset = static_cast<uint32_t>(samples_offset);
+        blocks_ = reinterpret_cast<BlockInfo*>(header_ + 1);
+        for (uint32_t b = 0; b < kBlockSlots; ++b) new (&blocks_[b]) BlockInfo{};
+        samples_ = reinterpret_cast<float*>(static_cast<char*>(map_) + samples_offset);
+        lanes_.resize(channels);
+        // Readers check the version last, so they never see a half-built header.
+        std::atomic_thread_fence(std::memory_order_release);
+        header_->version = kVersion;
+    }
+    ~SharedOutputTap() {
+#if defined(_WIN32)
+        UnmapViewOfFile(map_);
+        CloseHandle(mapping_);
+#else
+        munmap(map_, bytes_);
+        shm_unlink(name_.c_str());
+#endif
+    }
+
+    SharedOutputTap(const SharedOutputTap&) = delete;
+    SharedOutputTap& operator=(const SharedOutputTap&) = delete;
+
+    const std::string& name() const { return name_; }
+    uint64_t capacity() const { return header_->capacity; }
+
+    // Audio thread: appends one block of the mix, with the master gain applied.
+    void publish(const float* const* lanes, unsigned long frames, float gain, uint64_t sample_time, double dac_time) {
+        const uint64_t capacity = header_->capacity;
+        const uint64_t first = header_->committed_frames.load(std::memory_order_relaxed);
+        header_->reserved_frames.store(first + frames, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        unsigned long done = 0;
+        while (done < frames) {
+            const uint64_t at = (first + done) & (capacity - 1);
+            const auto n = static_cast<unsigned long>(std::min<uint64_t>(frames - done, capacity - at));
+            for (int c = 0; c < channels_; ++c) lanes_[c] = lanes[c] + done;
+            interleave_with_gain(samples_ + at * channels_, lanes_.data(), channels_, n, gain);
+            done += n;
+        }
+        header_->committed_frames.store(first + frames, std::memory_order_release);
+
+        const uint64_t block = header_->blocks.load(std::memory_order_relaxed);
+        BlockInfo& info = blocks_[block % kBlockSlots];
+        info.seq.store(2 * block + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        info.first_frame = first;
+        info.sample_time = sample_time;
+        info.frames = frames;
+        info.dac_time = dac_time;
+        info.monotonic_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        info.seq.store(2 * block + 2, std::memory_order_release);
+        header_->blocks.store(block + 1, std::memory_order_release);
+    }
+
+private:
+    std::string name_;
+    int channels_;
+    std::size_t bytes_{0};
+    void* map_{nullptr};
+#if defined(_WIN32)
+    HANDLE mapping_{nullptr};
+#endif
+    Header* header_{nullptr};
+    BlockInfo* blocks_{nullptr};
+    float* samples_{nullptr};
+    std::vector<const float*> lanes_;
+
+    void _map() {
+#if defined(_WIN32)
+        const std::string object = "Local\\" + name_;
+        const auto size = static_cast<uint64_t>(bytes_);
+        mapping_ = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                      static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), object.c_str());
+        if (mapping_ == nullptr) throw std::runtime_error("Failed to create shared memory '" + object + "'");
+        map_ = MapViewOfFile(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, bytes_);
+        if (map_ == nullptr) {
+            CloseHandle(mapping_);
+            throw std::runtime_error("Failed to map shared memory '" + object + "'");
+        }
+        std::memset(map_, 0, bytes_);
+#else
+        if (name_.empty() || name_[0] != '/') name_ = "/" + name_;
+        // Start from a fresh object so readers never see a stale layout.
+        shm_unlink(name_.c_str());
+        const int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) throw std::runtime_error("Failed to create shared memory '" + name_ + "': " + std::strerror(errno));
+        if (ftruncate(fd, static_cast<off_t>(bytes_)) != 0) {
+            close(fd);
+            shm_unlink(name_.c_str());
+            throw std::runtime_error("Failed to size shared memory '" + name_ + "': " + std::strerror(errno));
+        }
+        map_ = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (map_ == MAP_FAILED) {
+            map_ = nullptr;
+            shm_unlink(name_.c_str());
+            throw std::runtime_error("Failed to map shared memory '" + name_ + "': " + std::strerror(errno));
+        }
+#endif
+    }
+};
+
+
+// The most recent output, for read_output(). Each lane holds the ring twice
+// over (frame i is written at i and i + capacity), so the latest n <= capacity
+// frames are always contiguous and NumPy can view them in place. The audio
+// thread only copies into it and never waits for readers.
+class CaptureRing {
+public:
+    CaptureRing(int channels, std::size_t capacity) : capacity_(capacity) {
+        lanes_.allocate(static_cast<std::size_t>(channels), 2 * capacity);
+    }
+
+    // Audio thread: appends one block, with the master gain applied.
+    void write(const float* const* lanes, unsigned long frames, float gain) {
+        const uint64_t written = written_.load(std::memory_order_relaxed);
+        for (std::size_t c = 0; c < lanes_.num_lanes(); ++c) {
+            float* ring = lanes_.lane(c);
+            const float* src = lanes[c];
+            std::size_t at = static_cast<std::size_t>(written % capacity_);
+            for (unsigned long i = 0; i < frames; ++i) {
+                ring[at] = ring[at + capacity_] = src[i] * gain;
+                if (++at == capacity_) at = 0;
+            }
+        }
+        written_.store(written + frames, std::memory_order_release);
+    }
+
+    // Start of the latest `frames` frames in every lane.
+    std::size_t latest(std::size_t frames) const {
+        return static_cast<std::size_t>(written_.load(std::memory_order_acquire) % capacity_) + capacity_ - frames;
+    }
+
+    std::size_t capacity() const { return capacity_; }
+    std::size_t channels() const { return lanes_.num_lanes(); }
+    const float* lane(std::size_t c) const { return lanes_.lane(c); }
+    std::size_t lane_stride() const { return lanes_.num_lanes() > 1 ? static_cast<std::size_t>(lanes_.lane(1) - lanes_.lane(0)) : 2 * capacity_; }
+
+private:
+    std::size_t capacity_;
+    ScratchArena lanes_;
+    std::atomic<uint64_t> written_{0};
+};
+
+
+// --- Native MIDI and OSC input ---
+// Incoming controller messages are mapped to synth parameters in C++ and
+// queued straight onto the engine's command queue, from RtMidi's callback
+// thread or the OSC socket thread, without going through Python. Only
+// messages with no binding are handed to the Python callback.
+
+// One OSC message: the address and its numeric ('i', 'f', 'd', 'h', 'T',
+// 'F') and string ('s') arguments. Other argument types end the parse.
+struct OscMessage {
+    std::string address;
+    std::vector<double> numbers;
+    std::vector<std::string> strings;
+    std::string types;  // tag of each argument kept, in order
+};
+
+inline bool osc_read_string(const uint8_t*& p, const uint8_t* end, std::string& out) {
+    const auto* terminator = static_cast<const uint8_t*>(std::memchr(p, 0, static_cast<std::size_t>(end - p)));
+    if (terminator == nullptr) return false;
+    out.assign(reinterpret_cast<const char*>(p), static_cast<std::size_t>(terminator - p));
+    const std::size_t padded = (out.size() + 4) & ~std::size_t{3};
+    if (static_cast<std::size_t>(end - p) < padded) return false;
+    p += padded;
+    return true;
+}
+
+inline uint64_t osc_read_be(const uint8_t*& p, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i) value = (value << 8) | *p++;
+    return value;
+}
+
+// Parses a packet, recursing into bundles (whose time tags are ignored:
+// everything is applied on arrival).
+inline void parse_osc(const uint8_t* data, std::size_t size, std::vector<OscMessage>& out) {
+    const uint8_t* p = data;
+    const uint8_t* end = data + size;
+    if (size >= 16 && std::memcmp(data, "#bundle", 8) == 0) {
+        p += 16;
+        while (end - p >= 4) {
+            const auto length = static_cast<std::size_t>(osc_read_be(p, 4));
+            if (length > static_cast<std::size_t>(end - p)) return;
+            parse_osc(p, length, out);
+            p += length;
+        }
+        return;
+    }
+    OscMessage message;
+    std::string tags;
+    if (!osc_read_string(p, end, message.address) || message.address.empty() || message.address[0] != '/') return;
+    if (p < end && !osc_read_string(p, end, tags)) return;
+    for (std::size_t t = 1; t < tags.size(); ++t) {
+        const char tag = tags[t];
+        const int bytes = tag == 'i' || tag == 'f' ? 4 : tag == 'd' || tag == 'h' ? 8 : 0;
+        if (bytes > 0 && end - p < bytes) break;
+        if (tag == 'i') {
+            message.numbers.push_back(static_cast<int32_t>(osc_read_be(p, 4)));
+        } else if (tag == 'h') {
+            message.numbers.push_back(static_cast<double>(static_cast<int64_t>(osc_read_be(p, 8))));
+        } else if (tag == 'f') {
+            const auto bits = static_cast<uint32_t>(osc_read_be(p, 4));
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            message.numbers.push_back(value);
+        } else if (tag == 'd') {
+            const uint64_t bits = osc_read_be(p, 8);
+            double value;
+            std::memcpy(&value, &bits, sizeof(value));
+            message.numbers.push_back(value);
+        } else if (tag == 'T' || tag == 'F') {
+            message.numbers.push_back(tag == 'T' ? 1.0 : 0.0);
+        } else if (tag == 's') {
+            std::string text;
+            if (!osc_read_string(p, end, text)) break;
+            message.strings.push_back(std::move(text));
+        } else {
+            break;
+        }
+        message.types.push_back(tag);
+    }
+    out.push_back(std::move(message));
+}
+
+#if defined(_WIN32)
+using SocketHandle = SOCKET;
+constexpr SocketHandle kNoSocket = INVALID_SOCKET;
+inline void close_socket(SocketHandle s) { closesocket(s); }
+#else
+using SocketHandle = int;
+constexpr SocketHandle kNoSocket = -1;
+inline void close_socket(SocketHandle s) { ::close(s); }
+#endif
+
+// What an input message drives. Values are scaled from the message's
+// natural range (0-1 for MIDI controllers and pitch bend, as sent for OSC)
+// onto [lo, hi].
+struct InputBinding {
+    enum class Source : uint8_t { ControlChange, PitchBend, Notes, Osc };
+    Source source;
+    int channel;          // MIDI channel 0-15, or -1 for any
+    int number;           // controller number (ControlChange)
+    std::string address;  // Osc
+    Handle synth;
+    uint64_t serial;
+    Command::Type param;  // ignored for Notes, which play note_on/note_off
+    double lo;
+    double hi;
+};
+
+// Runs `f` with the GIL released, if this thread holds it: for waits that
+// may be entered from Python or from a native thread.
+template <typename F>
+void without_gil(F&& f) {
+    if (PyGILState_Check()) {
+        py::gil_scoped_release release;
+        f();
+    } else {
+        f();
+    }
+}
+
+class AudioEngine;
+
+class ControlInput {
+public:
+    explicit ControlInput(AudioEngine* engine) : engine_(engine) {}
+    ~ControlInput() {
+        close_osc();
+        close_midi();
+    }
+
+    void add_binding(InputBinding binding) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = std::find_if(bindings_.begin(), bindings_.end(), [&](const InputBinding& b) {
+            return b.source == binding.source && b.channel == binding.channel && b.number == binding.number
+                && b.address == binding.address && b.synth == binding.synth && b.param == binding.param;
+        });
+        if (it != bindings_.end()) {
+            *it = std::move(binding);
+        } else {
+            bindings_.push_back(std::move(binding));
+        }
+    }
+
+    void clear_bindings() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        bindings_.clear();
+    }
+
+    std::size_t num_bindings() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return bindings_.size();
+    }
+
+    // Called with the GIL held.
+    void set_callback(py::function callback) { callback_ = std::move(callback); }
+
+    void open_osc(int port, const std::string& host) {
+        close_osc();
+#if defined(_WIN32)
+        WSADATA wsa;
+        if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) throw std::runtime_error("Failed to initialize Winsock.");
+        wsa_started_ = true;
+#endif
+        SocketHandle s = ::socket(AF_INET, SOCK_DGRAM, 0);
+        if (s == kNoSocket) throw std::runtime_error("Failed to create the OSC input socket.");
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(port));
+        if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+            close_socket(s);
+            throw std::runtime_error("Invalid OSC input address '" + host + "'.");
+        }
+        if (::bind(s, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            close_socket(s);
+            throw std::runtime_error("Failed to listen for OSC on " + host + ":" + std::to_string(port) + ".");
+        }
+        // Wake up regularly to notice close_osc().
+#if defined(_WIN32)
+        const DWORD timeout_ms = 100;
+        setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout_ms), sizeof(timeout_ms));
+#else
+        timeval timeout{0, 100000};
+        setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#endif
+        socket_ = s;
+        osc_running_.store(true);
+        osc_thread_ = std::thread(&ControlInput::_osc_loop, this);
+        py::print("Listening for OSC on ", host, ":", port);
+    }
+
+    void close_osc() {
+        if (!osc_thread_.joinable()) return;
+        osc_running_.store(false);
+        without_gil([this] { osc_thread_.join(); });
+        close_socket(socket_);
+        socket_ = kNoSocket;
+#if defined(_WIN32)
+        if (wsa_started_) WSACleanup();
+        wsa_started_ = false;
+#endif
+    }
+
+    void open_midi(int port) {
+#ifdef OSCAR_HAVE_RTMIDI
+        close_midi();
+        try {
+            auto midi = std::make_unique<RtMidiIn>();
+            if (port < 0 || static_cast<unsigned>(port) >= midi->getPortCount()) {
+                throw std::runtime_error("No MIDI input port " + std::to_string(port) + ".");
+            }
+            midi->openPort(static_cast<unsigned>(port), "oscar");
+            midi->ignoreTypes(true, true, true);  // sysex, timing, active sensing
+            midi->setCallback(&ControlInput::_midi_callback, this);
+            py::print("Listening for MIDI on '", midi->getPortName(static_cast<unsigned>(port)), "'");
+            midi_ = std::move(midi);
+        } catch (const RtMidiError& error) {
+            throw std::runtime_error("Failed to open MIDI input: " + error.getMessage());
+        }
+#else
+        (void)port;
+        throw std::runtime_error("This build has no native MIDI support (RtMidi was not found by setup.py).");
+#endif
+    }
+
+    void close_midi() {
+#ifdef OSCAR_HAVE_RTMIDI
+        if (!midi_) return;
+        // RtMidi joins its callback thread, which may be waiting for the GIL.
+        without_gil([this] {
+            midi_->cancelCallback();
+            midi_->closePort();
+        });
+        midi_.reset();
+#endif
+    }
+
+    static std::vector<std::string> midi_ports() {
+        std::vector<std::string> names;
+#ifdef OSCAR_HAVE_RTMIDI
+        try {
+            RtMidiIn midi;
+            for (unsigned i = 0; i < midi.getPortCount(); ++i) names.push_back(midi.getPortName(i));
+        } catch (const RtMidiError&) {
+        }
+#endif
+        return names;
+    }
+
+    // Input threads (public for testing without a device): maps a raw MIDI
+    // message or an OSC packet.
+    void handle_midi(const uint8_t* bytes, std::size_t size) {
+        if (size < 2) return;
+        const int status = bytes[0] & 0xF0;
+        const int channel = bytes[0] & 0x0F;
+        const int data1 = bytes[1] & 0x7F;
+        const int data2 = size > 2 ? bytes[2] & 0x7F : 0;
+        bool mapped = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const InputBinding& b : bindings_) {
+                if (b.channel >= 0 && b.channel != channel) continue;
+                if (status == 0xB0 && b.source == InputBinding::Source::ControlChange && b.number == data1) {
+                    _post(b, b.param, b.lo + (b.hi - b.lo) * (data2 / 127.0));
+                    mapped = true;
+                } else if (status == 0xE0 && b.source == InputBinding::Source::PitchBend) {
+                    _post(b, b.param, b.lo + (b.hi - b.lo) * (((data2 << 7) | data1) / 16383.0));
+                    mapped = true;
+                } else if ((status == 0x90 || status == 0x80) && b.source == InputBinding::Source::Notes) {
+                    const bool on = status == 0x90 && data2 > 0;
+                    _post(b, on ? Command::Type::NoteOn : Command::Type::NoteOff, data1, data2 / 127.f);
+                    mapped = true;
+                }
+            }
+        }
+        if (!mapped) _unmapped_midi(bytes, size);
+    }
+
+    void handle_osc(const uint8_t* data, std::size_t size) {
+        osc_messages_.clear();
+        parse_osc(data, size, osc_messages_);
+        for (const OscMessage& message : osc_messages_) {
+            bool mapped = false;
+            if (!message.numbers.empty()) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (const InputBinding& b : bindings_) {
+                    if (b.source != InputBinding::Source::Osc || b.address != message.address) continue;
+                    _post(b, b.param, b.lo + (b.hi - b.lo) * message.numbers.front());
+                    mapped = true;
+                }
+            }
+            if (!mapped) _unmapped_osc(message);
+        }
+    }
+
+private:
+    AudioEngine* engine_;
+    std::mutex mutex_;  // guards bindings_, shared by both input threads
+    std::vector<InputBinding> bindings_;
+    py::function callback_;  // guarded by the GIL
+    std::atomic<bool> osc_running_{false};
+    std::thread osc_thread_;
+    SocketHandle socket_{kNoSocket};
+    std::vector<OscMessage> osc_messages_;  // OSC thread only
+#if defined(_WIN32)
+    bool wsa_started_{false};
+#endif
+#ifdef OSCAR_HAVE_RTMIDI
+    std::unique_ptr<RtMidiIn> midi_;
+#endif
+
+    // Defined after AudioEngine.
+    void _post(const InputBinding& binding, Command::Type type, double value, float velocity = 0.f);
+
+    void _osc_loop() {
+        std::vector<uint8_t> packet(65536);
+        while (osc_running_.load()) {
+            const auto received = ::recvfrom(socket_, reinterpret_cast<char*>(packet.data()), static_cast<int>(packet.size()), 0, nullptr, nullptr);
+            if (received > 0) handle_osc(packet.data(), static_cast<std::size_t>(received));
+        }
+    }
+
+#ifdef OSCAR_HAVE_RTMIDI
+    static void _midi_callback(double, std::vector<unsigned char>* message, void* user) {
+        if (message != nullptr) static_cast<ControlInput*>(user)->handle_midi(message->data(), message->size());
+    }
+#endif
+
+    void _unmapped_midi(const uint8_t* bytes, std::size_t size) {
+        if (!Py_IsInitialized()) return;
+        py::gil_scoped_acquire gil;
+        if (!callback_) return;
+        py::list data;
+        for (std::size_t i = 0; i < size; ++i) data.append(static_cast<int>(bytes[i]));
+        _call(py::str("midi"), py::str(""), data);
+    }
+
+    void _unmapped_osc(const OscMessage& message) {
+        if (!Py_IsInitialized()) return;
+        py::gil_scoped_acquire gil;
+        if (!callback_) return;
+        py::list args;
+        std::size_t number = 0, text = 0;
+        for (char tag : message.types) {
+            if (tag == 's') {
+                args.append(py::str(message.strings[text++]));
+            } else if (tag == 'i' || tag == 'h') {
+                args.append(static_cast<int64_t>(message.numbers[number++]));
+            } else {
+                args.append(message.numbers[number++]);
+            }
+        }
+        _call(py::str("osc"), py::str(message.address), args);
+    }
+
+    // With the GIL held. A failing callback is reported, not propagated
+    // into the input thread.
+    void _call(const py::str& source, const py::str& address, const py::list& values) {
+        try {
+            callback_(source, address, values);
+        } catch (py::error_already_set& error) {
+            py::print("Input callback failed: ", error.what());
+        }
+    }
+};
+
+
+// --- Scenes ---
+// A scene is a snapshot of everything the engine plays: its synths (with
+// their tables, mip levels already built), buses, patches, modulation
+// routes and master volume. Scenes are kept in engine memory, so recalling
+// one copies tables and publishes one render graph, with no Python calls or
+// FFTs in between. Tables that are the same in several scenes are shared.
+
+struct SceneSynth {
+    std::string name;
+    std::shared_ptr<const Wavetable> table;
+    uint32_t voices{0};
+    bool playing{false};
+    double frequency{440.0};
+    double amplitude{0.5};
+    double phase_offset{0.0};
+    double position{0.0};
+    PhaseMode phase_mode{PhaseMode::Absolute};
+    double resync_seconds{1.0};
+    bool band_limited{true};
+    Interpolation interpolation{Interpolation::Linear};
+    float envelope[4]{0.005f, 0.1f, 0.8f, 0.2f};  // attack, decay, sustain, release
+};
+
+struct SceneBus {
+    std::string name;
+    std::string parent;
+    std::vector<int> channels;
+    uint32_t oversampling{1};
+    float transform[7]{1.f, 1.f, 0.f, 0.f, 1.f, 0.f, 0.f};  // gain, a, b, c, d, tx, ty
+};
+
+struct ScenePatch {
+    std::string name;
+    std::string synth;
+    std::string bus;
+    std::vector<int> channels;
+};
+
+struct SceneModulation {
+    std::string source;
+    std::string target;
+    ModParam param;
+    double depth;
+};
+
+struct Scene {
+    std::vector<SceneSynth> synths;
+    std::vector<SceneBus> buses;
+    std::vector<ScenePatch> patches;
+    std::vector<SceneModulation> modulations;
+    float master_volume{1.f};
+};
+
+using SceneMap = std::map<std::string, std::shared_ptr<const Scene>>;
+
+// Scene files are little-endian:
+//   "OSCS", u32 version
+//   u32 tables, each: u32 size (a power of two), u32 frames, f32 samples[frames * size]
+//   u32 scenes, each: str name, f32 master volume, then
+//     u32 synths, each: str name, u32 table index, u32 voices, u8 playing,
+//       f64 frequency, amplitude, phase offset, position, u8 phase mode,
+//       f64 resync seconds, u8 band limited, u8 interpolation, f32 envelope[4]
+//     u32 buses, each: str name, str parent, ints channels, u8 oversampling, f32 transform[7]
+//     u32 patches, each: str name, str synth, str bus, ints channels
+//     u32 modulations, each: str source, str target, u8 param, f64 depth
+// where str is a u32 length and its bytes, and ints is a u32 count and
+// that many i32. Tables keep only the samples as given: the mip levels
+// are rebuilt on load, which is what keeps the file compact.
+constexpr char kSceneMagic[4] = {'O', 'S', 'C', 'S'};
+constexpr uint32_t kSceneVersion = 1;
+
+template <typename T>
+using SceneBits = std::conditional_t<sizeof(T) == 8, uint64_t, std::conditional_t<sizeof(T) == 4, uint32_t, uint8_t>>;
+
+class SceneWriter {
+public:
+    template <typename T>
+    void put(T value) {
+        static_assert(std::is_arithmetic_v<T> && (sizeof(T) == 1 || sizeof(T) == 4 || sizeof(T) == 8));
+        SceneBits<T> bits;
+        std::memcpy(&bits, &value, sizeof(T));
+        for (std::size_t i = 0; i < sizeof(T); ++i) bytes_.push_back(static_cast<uint8_t>(bits >> (8 * i)));
+    }
+    void put_string(const std::string& text) {
+        put(static_cast<uint32_t>(text.size()));
+        bytes_.insert(bytes_.end(), text.begin(), text.end());
+    }
+    void put_ints(const std::vector<int>& values) {
+        put(static_cast<uint32_t>(values.size()));
+        for (int v : values) put(static_cast<int32_t>(v));
+    }
+    void put_raw(const char* data, std::size_t size) { bytes_.insert(bytes_.end(), data, data + size); }
+
+    const std::vector<uint8_t>& bytes() const { return bytes_; }
+
+private:
+    std::vector<uint8_t> bytes_;
+};
+
+// Reads what SceneWriter wrote. Running off the end, or a count larger
+// than what is left, is an error rather than a huge allocation.
+class SceneReader {
+public:
+    SceneReader(const uint8_t* data, std::size_t size) : p_(data), end_(data + size) {}
+
+    template <typename T>
+    T get() {
+        _need(sizeof(T));
+        SceneBits<T> bits = 0;
+        for (std::size_t i = 0; i < sizeof(T); ++i) bits |= static_cast<SceneBits<T>>(static_cast<SceneBits<T>>(p_[i]) << (8 * i));
+        p_ += sizeof(T);
+        T value;
+        std::memcpy(&value, &bits, sizeof(T));
+        return value;
+    }
+    // A count of items at least `item_bytes` long each.
+    uint32_t get_count(std::size_t item_bytes = 1) {
+        const auto count = get<uint32_t>();
+        if (count > remaining() / item_bytes) throw std::runtime_error("Scene file is corrupt: bad count.");
+        return count;
+    }
+    std::string get_string() {
+        const uint32_t size = get_count();
+        std::string text(reinterpret_cast<const char*>(p_), size);
+        p_ += size;
+        return text;
+    }
+    std::vector<int> get_ints() {
+        std::vector<int> values(get_count(4));
+        for (int& v : values) v = get<int32_t>();
+        return values;
+    }
+    template <typename E>
+    E get_enum(std::size_t count) {
+        const auto value = get<uint8_t>();
+        if (value >= count) throw std::runtime_error("Scene file is corrupt: bad enum value.");
+        return static_cast<E>(value);
+    }
+    bool starts_with(const char* magic, std::size_t size) {
+        if (remaining() < size || std::memcmp(p_, magic, size) != 0) return false;
+        p_ += size;
+        return true;
+    }
+    std::size_t remaining() const { return static_cast<std::size_t>(end_ - p_); }
+
+private:
+    const uint8_t* p_;
+    const uint8_t* end_;
+
+    void _need(std::size_t bytes) const {
+        if (remaining() < bytes) throw std::runtime_error("Scene file is truncated.");
+    }
+};
+
+inline std::vector<uint8_t> write_scenes(const SceneMap& scenes) {
+    SceneWriter out;
+    out.put_raw(kSceneMagic, sizeof(kSceneMagic));
+    out.put(kSceneVersion);
+
+    std::map<const Wavetable*, uint32_t> table_index;
+    std::vector<const Wavetable*> tables;
+    for (const auto& [name, scene] : scenes) {
+        for (const auto& synth : scene->synths) {
+            if (table_index.emplace(synth.table.get(), static_cast<uint32_t>(tables.size())).second) tables.push_back(synth.table.get());
+        }
+    }
+    out.put(static_cast<uint32_t>(tables.size()));
+    for (const Wavetable* table : tables) {
+        const std::size_t size = std::size_t{1} << table->bits;
+        out.put(static_cast<uint32_t>(size));
+        out.put(table->frames);
+        for (unsigned f = 0; f < table->frames; ++f) {
+            const float* samples = table->samples(0, f);
+            for (std::size_t i = 0; i < size; ++i) out.put(samples[i]);
+        }
+    }
+
+    out.put(static_cast<uint32_t>(scenes.size()));
+    for (const auto& [name, scene] : scenes) {
+        out.put_string(name);
+        out.put(scene->master_volume);
+        out.put(static_cast<uint32_t>(scene->synths.size()));
+        for (const auto& synth : scene->synths) {
+            out.put_string(synth.name);
+            out.put(table_index.at(synth.table.get()));
+            out.put(synth.voices);
+            out.put(static_cast<uint8_t>(synth.playing));
+            out.put(synth.frequency);
+            out.put(synth.amplitude);
+            out.put(synth.phase_offset);
+            out.put(synth.position);
+            out.put(static_cast<uint8_t>(synth.phase_mode));
+            out.put(synth.resync_seconds);
+            out.put(static_cast<uint8_t>(synth.band_limited));
+            out.put(static_cast<uint8_t>(synth.interpolation));
+            for (float v : synth.envelope) out.put(v);
+        }
+        out.put(static_cast<uint32_t>(scene->buses.size()));
+        for (const auto& bus : scene->buses) {
+            out.put_string(bus.name);
+            out.put_string(bus.parent);
+            out.put_ints(bus.channels);
+            out.put(static_cast<uint8_t>(bus.oversampling));
+            for (float v : bus.transform) out.put(v);
+        }
+        out.put(static_cast<uint32_t>(scene->patches.size()));
+        for (const auto& patch : scene->patches) {
+            out.put_string(patch.name);
+            out.put_string(patch.synth);
+            out.put_string(patch.bus);
+            out.put_ints(patch.channels);
+        }
+        out.put(static_cast<uint32_t>(scene->modulations.size()));
+        for (const auto& mod : scene->modulations) {
+            out.put_string(mod.source);
+            out.put_string(mod.target);
+            out.put(static_cast<uint8_t>(mod.param));
+            out.put(mod.depth);
+        }
+    }
+    return out.bytes();
+}
+
+// Checks a scene's references hang together (a file may have been edited
+// or damaged), with the same rules as building it call by call.
+inline void check_scene(const std::string& name, const Scene& scene, unsigned max_voices) {
+    auto fail = [&](const std::string& why) { throw std::runtime_error("Scene '" + name + "' " + why); };
+    std::map<std::string, std::size_t> synths, buses;
+    for (std::size_t i = 0; i < scene.synths.size(); ++i) {
+        const auto& synth = scene.synths[i];
+        if (!synths.emplace(synth.name, i).second) fail("has two synths named '" + synth.name + "'.");
+        if (synth.voices > max_voices) fail("gives synth '" + synth.name + "' more than " + std::to_string(max_voices) + " voices.");
+    }
+    for (std::size_t i = 0; i < scene.buses.size(); ++i) {
+        const auto& bus = scene.buses[i];
+        if (bus.name.empty() || !buses.emplace(bus.name, i).second) fail("has an unnamed or repeated bus.");
+        if (bus.oversampling != 1 && bus.oversampling != 2 && bus.oversampling != 4 && bus.oversampling != 8) {
+            fail("oversamples bus '" + bus.name + "' by " + std::to_string(bus.oversampling) + ".");
+        }
+    }
+    for (const auto& bus : scene.buses) {
+        std::size_t steps = 0;
+        for (std::string parent = bus.parent; !parent.empty(); parent = scene.buses[buses[parent]].parent) {
+            if (!buses.count(parent)) fail("routes bus '" + bus.name + "' into missing bus '" + parent + "'.");
+            if (++steps > scene.buses.size()) fail("has a loop of buses through '" + bus.name + "'.");
+        }
+    }
+    std::map<std::string, int> patches;
+    for (const auto& patch : scene.patches) {
+        if (++patches[patch.name] > 1) fail("has two patches named '" + patch.name + "'.");
+        if (!synths.count(patch.synth)) fail("patches missing synth '" + patch.synth + "'.");
+        if (!patch.bus.empty() && !buses.count(patch.bus)) fail("patches into missing bus '" + patch.bus + "'.");
+    }
+    // A modulation chain longer than there are synths must go round a loop.
+    std::vector<std::size_t> depth(scene.synths.size(), 0);
+    for (const auto& mod : scene.modulations) {
+        if (!synths.count(mod.source) || !synths.count(mod.target) || mod.source == mod.target) {
+            fail("has a bad modulation from '" + mod.source + "' to '" + mod.target + "'.");
+        }
+    }
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (const auto& mod : scene.modulations) {
+            const std::size_t from = synths[mod.source], to = synths[mod.target];
+            if (depth[to] < depth[from] + 1) {
+                depth[to] = depth[from] + 1;
+                if (depth[to] > scene.synths.size()) fail("has a modulation loop.");
+                changed = true;
+            }
+        }
+    }
+}
+
+// Every scene in a file, checked. Throws without keeping any of them if the
+// file is damaged.
+inline SceneMap read_scenes(const std::vector<uint8_t>& bytes, unsigned max_voices) {
+    SceneReader in(bytes.data(), bytes.size());
+    if (!in.starts_with(kSceneMagic, sizeof(kSceneMagic))) throw std::runtime_error("Not a scene file.");
+    const auto version = in.get<uint32_t>();
+    if (version != kSceneVersion) throw std::runtime_error("Unsupported scene file version " + std::to_string(version) + ".");
+
+    std::vector<std::shared_ptr<const Wavetable>> tables(in.get_count(8));
+    std::vector<float> samples;
+    for (auto& table : tables) {
+        const auto size = in.get<uint32_t>();
+        const auto frames = in.get<uint32_t>();
+        if (size < (std::size_t{1} << kMinTableBits) || size > (std::size_t{1} << kMaxTableBits) || (size & (size - 1)) != 0
+            || frames == 0 || static_cast<uint64_t>(size) * frames > in.remaining() / 4) {
+            throw std::runtime_error("Scene file is corrupt: bad table size.");
+        }
+        samples.resize(static_cast<std::size_t>(size) * frames);
+        for (float& v : samples) v = in.get<float>();
+        table = std::make_shared<const Wavetable>(samples.data(), size, frames);
+    }
+
+    SceneMap scenes;
+    const uint32_t num_scenes = in.get_count();
+    for (uint32_t s = 0; s < num_scenes; ++s) {
+        const std::string name = in.get_string();
+        auto scene = std::make_shared<Scene>();
+        scene->master_volume = in.get<float>();
+        scene->synths.resize(in.get_count());
+        for (auto& synth : scene->synths) {
+            synth.name = in.get_string();
+            const auto table = in.get<uint32_t>();
+            if (table >= tables.size()) throw std::runtime_error("Scene file is corrupt: bad table index.");
+            synth.table = tables[table];
+            synth.voices = in.get<uint32_t>();
+            synth.playing = in.get<uint8_t>() != 0;
+            synth.frequency = in.get<double>();
+            synth.amplitude = in.get<double>();
+            synth.phase_offset = in.get<double>();
+            synth.position = in.get<double>();
+            synth.phase_mode = in.get_enum<PhaseMode>(2);
+            synth.resync_seconds = in.get<double>();
+            synth.band_limited = in.get<uint8_t>() != 0;
+            synth.interpolation = in.get_enum<Interpolation>(kNumInterpolations);
+            for (float& v : synth.envelope) v = in.get<float>();
+        }
+        scene->buses.resize(in.get_count());
+        for (auto& bus : scene->buses) {
+            bus.name = in.get_string();
+            bus.parent = in.get_string();
+            bus.channels = in.get_ints();
+            bus.oversampling = in.get<uint8_t>();
+            for (float& v : bus.transform) v = in.get<float>();
+        }
+        scene->patches.resize(in.get_count());
+        for (auto& patch : scene->patches) {
+            patch.name = in.get_string();
+            patch.synth = in.get_string();
+            patch.bus = in.get_string();
+            patch.channels = in.get_ints();
+        }
+        scene->modulations.resize(in.get_count());
+        for (auto& mod : scene->modulations) {
+            mod.source = in.get_string();
+            mod.target = in.get_string();
+            mod.param = in.get_enum<ModParam>(kNumModParams);
+            mod.depth = in.get<double>();
+        }
+        check_scene(name, *scene, max_voices);
+        scenes[name] = std::move(scene);
+    }
+    return scenes;
+}
+
+
+// Immutable snapshot of everything the audio thread needs to render a buffer.
+// The control thread builds a new one on every graph edit and publishes it
+// with a single atomic pointer swap; the audio thread only ever reads it.
+// Everything is stored in flat arrays indexed by handle, so rendering is a
+// linear walk with no name lookups or reference counting.
+struct RenderGraph {
+    struct Route {
+        Handle synth;
+        uint32_t slot;           // into render_list
+        uint32_t first_channel;  // into channels
+        uint32_t num_channels;
+        bool first_use;          // first route to read this slot's buffer
+    };
+    std::vector<Synth*> synths;  // indexed by synth handle, null for free slots
+    // The serial the next synth will get: every synth with an older serial
+    // was created before this graph, so it is in `synths` unless deleted.
+    uint64_t next_serial{0};
+    std::vector<Route> routes;   // one per patch, in patch handle order
+    std::vector<int> channels;   // every route's output lanes (into mix_lanes), back to back
+
+    // Sub-mix buses, children before parents, so each bus is complete by the
+    // time it is mixed onward. Bus b owns submix_buffers lanes 2b (X) and
+    // 2b + 1 (Y); its outputs are mix_lanes indices.
+    struct BusStage {
+        Bus* bus;
+        uint32_t lanes;
+        uint32_t out_x;
+        uint32_t out_y;
+    };
+    std::vector<BusStage> buses;
+    std::vector<std::shared_ptr<Bus>> bus_owners;
+    // The device lanes, then every bus's two lanes, then a lane for bus
+    // outputs that go nowhere.
+    std::vector<float*> mix_lanes;
+    uint32_t discard_lane{0};
+    std::vector<Handle> render_list;  // each routed or modulating synth once, in wave order
+    std::vector<uint32_t> slot_of;    // render_list slot by synth handle, kNoSlot if not rendered
+    // Wave w is render_list[waves[w], waves[w + 1]). A synth's modulators are
+    // all in earlier waves, so each wave can be rendered in parallel.
+    std::vector<uint32_t> waves;
+
+    struct Modulation {
+        uint32_t source_slot;
+        ModParam param;
+        float depth;
+    };
+    // Slot i is modulated by modulations[mod_begin[i], mod_begin[i + 1]) and sums
+    // them into mod_buffers lanes mod_lanes[i] + param (kNoSlot if unmodulated).
+    std::vector<Modulation> modulations;
+    std::vector<uint32_t> mod_begin;
+    std::vector<uint32_t> mod_lanes;
+    // Per slot: the factor the synth renders at (see Bus::set_oversampling).
+    std::vector<uint8_t> oversampling;
+    float master_volume{1.f};
+    // Keeps the synths alive for as long as the audio thread may use this graph.
+    std::vector<std::shared_ptr<Synth>> owners;
+    // A scene recall's crossfade: the graph being faded out, rendered
+    // alongside this one for scene_fade frames from the first block that
+    // uses this one. Graphs published during the fade carry it on under the
+    // same id, so the fade doesn't restart.
+    std::shared_ptr<const RenderGraph> outgoing;
+    uint64_t scene_fade{0};
+    uint64_t scene_fade_id{0};
+
+    // Per-render_list-slot output, written by the audio thread (and render
+    // workers) while the graph is live.
+    mutable ScratchArena synth_buffers;
+    mutable std::vector<uint8_t> slot_active;
+    // This block's commands for slot i are events[event_begin[i], event_begin[i + 1]).
+    mutable std::vector<uint32_t> event_begin;
+    mutable ScratchArena mod_buffers;
+    mutable ScratchArena submix_buffers;
+
+    static constexpr uint32_t kNoSlot = UINT32_MAX;
+};
+
+
+class AudioEngine {
+private:
+    PaStream* stream_{nullptr};
+    double sample_rate_;
+    int numOutputChannels_{0};
+    float master_volume{1.f};
+    // Master clock in samples. Only the audio thread advances it.
+    std::atomic<uint64_t> master_phase_{0};
+    
+    // Control-plane registry. Only touched by the Python side, under
+    // control_mutex_; the audio thread never takes this lock. Names map to
+    // handles, and handles index the slot tables.
+    std::map<std::string, Handle> synth_handles_;
+    std::map<std::string, Handle> patch_handles_;
+    std::vector<std::shared_ptr<Synth>> synth_slots_;
+    std::vector<std::shared_ptr<Patch>> patch_slots_;
+    std::vector<Handle> free_synth_handles_;
+    std::vector<Handle> free_patch_handles_;
+    std::map<std::string, Handle> bus_handles_;
+    std::vector<std::shared_ptr<Bus>> bus_slots_;
+    std::vector<Handle> free_bus_handles_;
+    struct ModRoute {
+        Handle source;
+        Handle target;
+        ModParam param;
+        double depth;
+    };
+    std::vector<ModRoute> mod_routes_;
+    std::mutex control_mutex_;
+
+    // RCU-style publication of the render graph. callback_epoch_ is bumped on
+    // entry and exit of paCallback, so it is odd while the audio thread may be
+    // holding a graph pointer. A retired graph is freed once the epoch has moved
+    // on from the value seen at retirement (or immediately if it was even).
+    std::atomic<RenderGraph*> graph_{nullptr};
+    std::atomic<uint64_t> callback_epoch_{0};
+    std::vector<std::pair<RenderGraph*, uint64_t>> retired_graphs_;
+
+    // Retired graphs (and any synths they were the last owner of) are freed by
+    // this thread, never by the audio callback or while holding up a control call.
+    std::thread reaper_;
+    std::condition_variable reaper_cv_;
+    bool reaper_running_{false};
+
+    // Upper bound on a polyphonic synth's voice pool; every voice is
+    // scanned on each note-on.
+    static constexpr unsigned kMaxVoices = 128;
+
+    // Planar mix bus, one lane per output channel, sized from the stream's
+    // negotiated buffer size. Host buffers larger than this are rendered in
+    // several blocks. Synth output itself goes to the per-graph slot buffers.
+    static constexpr unsigned long kMinBlockFrames = 256;
+    static constexpr unsigned long kMaxBlockFrames = 8192;
+    ScratchArena scratch_;
+    std::vector<float*> bus_lanes_;
+    bool output_non_interleaved_{false};
+    SampleFormat output_format_{SampleFormat::Float32};
+    bool output_dither_{false};
+    TpdfDither dither_;
+    std::atomic<SharedOutputTap*> output_tap_{nullptr};
+    // The audio thread reads capture_ring_; capture_ keeps it alive for the
+    // engine, and NumPy views from read_output() hold their own reference.
+    std::atomic<CaptureRing*> capture_ring_{nullptr};
+    std::shared_ptr<CaptureRing> capture_;
+
+    // Optional parallel rendering. If the workers don't finish a batch by the
+    // deadline (a fraction of the buffer period), the engine falls back to
+    // rendering on the callback thread alone for about a second.
+    std::atomic<RenderWorkerPool*> pool_{nullptr};
+    std::atomic<double> parallel_deadline_fraction_{0.5};
+    std::chrono::steady_clock::time_point callback_deadline_;
+    unsigned long parallel_cooldown_{0};
+    std::atomic<uint64_t> parallel_deadline_misses_{0};
+    std::atomic<uint64_t> render_cache_hits_{0};
+    std::mutex offline_mutex_;
+    CallbackStats callback_stats_;
+    unsigned long frames_per_buffer_{0};  // 0: the host's choice
+    // Host-API stream info has to outlive Pa_OpenStream.
+#ifdef OSCAR_PA_MAC_CORE
+    std::vector<SInt32> channel_map_;
+    PaMacCoreStreamInfo mac_core_info_;
+#endif
+#ifdef OSCAR_PA_ASIO
+    std::vector<int> channel_map_;
+    PaAsioStreamInfo asio_info_;
+#endif
+    std::atomic<double> output_latency_{0.0};
+    // MIDI and OSC input, created by the first open_*_input or bind_* call.
+    std::unique_ptr<ControlInput> input_;
+
+    // Stored scenes (see store_scene), under control_mutex_.
+    SceneMap scenes_;
+    uint64_t next_scene_fade_id_{1};
+    // Audio thread: the scene crossfade being rendered and the master clock
+    // sample it started at. scene_faded_ is the id of the last one to
+    // finish, so the control side can stop carrying it.
+    uint64_t scene_fade_id_{0};
+    uint64_t scene_fade_start_{0};
+    std::atomic<uint64_t> scene_faded_{0};
+    ScratchArena scene_fade_buffer_;  // the outgoing scene's device lanes, per block
+
+    // Parameter changes from the control side. Producers serialize on
+    // command_mutex_ (never taken by the audio thread), so the ring itself only
+    // ever sees one producer. The callback drains it into pending_commands_,
+    // which holds commands until the block they are timestamped for; both
+    // that and block_events_ are reserved up front and never grow.
+    static constexpr std::size_t kCommandQueueCapacity = 4096;
+    SpscRing<Command> commands_{kCommandQueueCapacity};
+    std::mutex command_mutex_;
+    uint64_t next_command_seq_{0};
+    uint64_t next_synth_serial_{1};
+
+    struct BlockEvent {
+        uint32_t slot;    // RenderGraph::kNoSlot for synths that aren't rendered
+        uint32_t offset;  // frames into the block
+        Command command;
+    };
+    std::vector<Command> pending_commands_;
+    std::vector<BlockEvent> block_events_;
+
+    struct RenderJobContext {
+        const RenderGraph* graph;
+        const BlockEvent* events;
+        unsigned long frames;
+        uint64_t master_phase;
+        uint32_t first_slot;  // of the wave being rendered
+    };
+
+    // Renders one slot of the current wave, splitting the block at each of its
+    // commands so every change lands on its exact sample.
+    static void _render_job(void* context, uint32_t index) {
+        const auto& job = *static_cast<const RenderJobContext*>(context);
+        const RenderGraph& graph = *job.graph;
+        const uint32_t slot = job.first_slot + index;
+        Synth* synth = graph.synths[graph.render_list[slot]];
+        float* out = graph.synth_buffers.lane(slot);
+
+        // Modulators were rendered in an earlier wave; sum them per parameter.
+        ModInputs mod;
+        if (graph.mod_lanes[slot] != RenderGraph::kNoSlot) {
+            for (uint32_t m = graph.mod_begin[slot]; m < graph.mod_begin[slot + 1]; ++m) {
+                const RenderGraph::Modulation& modulation = graph.modulations[m];
+                if (!graph.slot_active[modulation.source_slot]) continue;
+                const auto param = static_cast<std::size_t>(modulation.param);
+                float* sum = graph.mod_buffers.lane(graph.mod_lanes[slot] + param);
+                if (mod.param[param] == nullptr) {
+                    std::fill_n(sum, job.frames, 0.f);
+                    mod.param[param] = sum;
+                }
+                mix_accumulate(sum, graph.synth_buffers.lane(modulation.source_slot), modulation.depth, job.frames);
+            }
+        }
+
+        const BlockEvent* event = job.events + graph.event_begin[slot];
+        const BlockEvent* end = job.events + graph.event_begin[slot + 1];
+        bool active = false;
+        unsigned long pos = 0;
+        while (pos < job.frames) {
+            for (; event != end && event->offset <= pos; ++event) {
+                synth->_apply(event->command, job.master_phase + event->offset);
+            }
+            const unsigned long stop = event != end ? event->offset : job.frames;
+            if (synth->is_playing()) {
+                ModInputs segment;
+                for (std::size_t p = 0; p < kNumModParams; ++p) {
+                    segment.param[p] = mod.at(static_cast<ModParam>(p), pos);
+                }
+                synth->render(out + pos, stop - pos, static_cast<double>(job.master_phase + pos), &segment, graph.oversampling[slot]);
+                active = true;
+            } else {
+                std::fill(out + pos, out + stop, 0.f);
+            }
+            pos = stop;
+        }
+        graph.slot_active[slot] = active;
+    }
+
+    // Blocks the calling (control) thread until any callback that was running
+    // when it was called has returned.
+    void _wait_for_callback() const {
+        const uint64_t epoch = callback_epoch_.load();
+        if (epoch % 2 == 0) return;
+        while (callback_epoch_.load() == epoch) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
+    template <typename T>
+    static Handle _allocate_slot(std::vector<std::shared_ptr<T>>& slots, std::vector<Handle>& free_handles, std::shared_ptr<T> item) {
+        Handle handle;
+        if (!free_handles.empty()) {
+            handle = free_handles.back();
+            free_handles.pop_back();
+            slots[handle] = std::move(item);
+        } else {
+            handle = static_cast<Handle>(slots.size());
+            slots.push_back(std::move(item));
+        }
+        return handle;
+    }
+
+    // Must be called with control_mutex_ held.
+    Handle _find_synth(const std::string& name) const {
+        auto it = synth_handles_.find(name);
+        return it == synth_handles_.end() ? kNoHandle : it->second;
+    }
+
+    // Must be called with control_mutex_ held. An empty name is no bus;
+    // an unknown one is an error.
+    Handle _resolve_bus(const std::string& name, const std::string& action) const {
+        if (name.empty()) return kNoHandle;
+        auto it = bus_handles_.find(name);
+        if (it == bus_handles_.end()) {
+            throw std::runtime_error(action + ": bus '" + name + "' does not exist.");
+        }
+        return it->second;
+    }
+
+    // Must be called with control_mutex_ held. Whether bus `from` is `to` or
+    // mixes into it, directly or through other buses.
+    bool _bus_reaches(Handle from, Handle to) const {
+        for (Handle h = from; h != kNoHandle; h = bus_slots_[h]->parent_handle_) {
+            if (h == to) return true;
+        }
+        return false;
+    }
+
+    // Must be called with control_mutex_ held. The oversampling a patch into
+    // bus `handle` needs: the highest of the bus and its parents.
+    unsigned _bus_oversampling(Handle handle) const {
+        unsigned factor = 1;
+        for (Handle h = handle; h != kNoHandle; h = bus_slots_[h]->parent_handle_) {
+            factor = std::max(factor, bus_slots_[h]->oversampling_);
+        }
+        return factor;
+    }
+
+    // Must be called with control_mutex_ held. Whether `from` modulates `to`,
+    // directly or through other synths.
+    bool _modulation_reaches(Handle from, Handle to) const {
+        std::vector<Handle> stack{from};
+        std::vector<uint8_t> seen(synth_slots_.size(), 0);
+        while (!stack.empty()) {
+            const Handle current = stack.back();
+            stack.pop_back();
+            if (current == to) return true;
+            if (seen[current]) continue;
+            seen[current] = 1;
+            for (const auto& mod : mod_routes_) {
+                if (mod.source == current) stack.push_back(mod.target);
+            }
+        }
+        return false;
+    }
+
+    // Must be called with control_mutex_ held.
+    void _remove_patch(Handle handle) {
+        auto& patch = patch_slots_[handle];
+        patch->engine_ = nullptr;
+        patch->handle_ = kNoHandle;
+        patch.reset();
+        free_patch_handles_.push_back(handle);
+    }
+
+    // Must be called with control_mutex_ held. Orders the buses deepest
+    // first and lays out their lanes in `graph`.
+    void _publish_buses(RenderGraph& graph) const {
+        std::vector<std::pair<uint32_t, Handle>> by_depth;
+        for (const auto& bus : bus_slots_) {
+            if (!bus) continue;
+            uint32_t depth = 0;
+            for (Handle h = bus->parent_handle_; h != kNoHandle; h = bus_slots_[h]->parent_handle_) ++depth;
+            by_depth.emplace_back(depth, bus->handle_);
+        }
+        std::sort(by_depth.begin(), by_depth.end(), [](const auto& a, const auto& b) {
+            return a.first != b.first ? a.first > b.first : a.second < b.second;
+        });
+        const auto num_buses = static_cast<uint32_t>(by_depth.size());
+        const auto device_lanes = static_cast<uint32_t>(this->numOutputChannels_);
+        std::vector<uint32_t> index_of(bus_slots_.size(), 0);
+        for (uint32_t b = 0; b < num_buses; ++b) index_of[by_depth[b].second] = b;
+
+        graph.discard_lane = device_lanes + 2 * num_buses;
+        graph.submix_buffers.allocate(2 * num_buses + 1, scratch_.max_frames());
+        graph.mix_lanes.assign(bus_lanes_.begin(), bus_lanes_.end());
+        for (uint32_t lane = 0; lane <= 2 * num_buses; ++lane) {
+            graph.mix_lanes.push_back(graph.submix_buffers.lane(lane));
+        }
+        for (const auto& [depth, handle] : by_depth) {
+            const auto& bus = bus_slots_[handle];
+            RenderGraph::BusStage stage{bus.get(), 2 * index_of[handle], graph.discard_lane, graph.discard_lane};
+            if (bus->parent_handle_ != kNoHandle) {
+                stage.out_x = device_lanes + 2 * index_of[bus->parent_handle_];
+                stage.out_y = stage.out_x + 1;
+            } else {
+                const auto& ch = bus->channels_;
+                if (ch.size() > 0 && ch[0] >= 0 && ch[0] < this->numOutputChannels_) stage.out_x = static_cast<uint32_t>(ch[0]);
+                if (ch.size() > 1 && ch[1] >= 0 && ch[1] < this->numOutputChannels_) stage.out_y = static_cast<uint32_t>(ch[1]);
+            }
+            graph.buses.push_back(stage);
+            graph.bus_owners.push_back(bus);
+        }
+    }
+
+    // Must be called with control_mutex_ held. With `scene_fade` frames, the
+    // graph being replaced is kept and crossfaded out (see recall_scene).
+    void _publish_graph(uint64_t scene_fade = 0) {
+        auto* next = new RenderGraph();
+        next->master_volume = master_volume;
+        next->synths.resize(synth_slots_.size(), nullptr);
+        next->next_serial = next_synth_serial_;
+        for (const auto& synth : synth_slots_) {
+            if (!synth) continue;
+            next->synths[synth->handle_] = synth.get();
+            next->owners.push_back(synth);
+        }
+        _publish_buses(*next);
+        std::vector<uint32_t> bus_index(bus_slots_.size(), 0);
+        for (uint32_t b = 0; b < next->buses.size(); ++b) {
+            bus_index[next->buses[b].bus->handle_] = b;
+        }
+
+        // Routes first; their slots are filled in once the render order is known.
+        const std::size_t num_handles = synth_slots_.size();
+        std::vector<uint8_t> rendered(num_handles, 0);
+        std::vector<uint8_t> oversampling(num_handles, 1);  // the most any of the synth's patches needs
+        std::vector<Handle> order;
+        for (const auto& patch : patch_slots_) {
+            if (!patch || next->synths[patch->synth_handle_] == nullptr) continue;
+            const bool first_use = !rendered[patch->synth_handle_];
+            RenderGraph::Route route{patch->synth_handle_, RenderGraph::kNoSlot, static_cast<uint32_t>(next->channels.size()), 0, first_use};
+            const bool to_bus = patch->bus_handle_ != kNoHandle;
+            const int num_lanes = to_bus ? 2 : this->numOutputChannels_;
+            const int first_lane = to_bus ? this->numOutputChannels_ + 2 * bus_index[patch->bus_handle_] : 0;
+            for (int channel_index : patch->channels_) {
+                if (channel_index >= 0 && channel_index < num_lanes) {
+                    next->channels.push_back(first_lane + channel_index);
+                    ++route.num_channels;
+                }
+            }
+            if (route.num_channels == 0) continue;
+            if (to_bus) {
+                auto& factor = oversampling[patch->synth_handle_];
+                factor = static_cast<uint8_t>(std::max<unsigned>(factor, _bus_oversampling(patch->bus_handle_)));
+            }
+            if (first_use) {
+                rendered[patch->synth_handle_] = 1;
+                order.push_back(patch->synth_handle_);
+            }
+            next->routes.push_back(route);
+        }
+
+        // Anything modulating a rendered synth is rendered too, patched or not.
+        for (std::size_t i = 0; i < order.size(); ++i) {
+            for (const auto& mod : mod_routes_) {
+                if (mod.target == order[i] && !rendered[mod.source]) {
+                    rendered[mod.source] = 1;
+                    order.push_back(mod.source);
+                }
+            }
+        }
+        // Wave = length of the longest modulation chain feeding a synth;
+        // modulate() keeps the routes acyclic, so this settles.
+        std::vector<uint32_t> wave(num_handles, 0);
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (const auto& mod : mod_routes_) {
+                if (rendered[mod.target] && wave[mod.target] < wave[mod.source] + 1) {
+                    wave[mod.target] = wave[mod.source] + 1;
+                    changed = true;
+                }
+            }
+        }
+        std::stable_sort(order.begin(), order.end(), [&](Handle a, Handle b) { return wave[a] < wave[b]; });
+
+        const auto num_slots = static_cast<uint32_t>(order.size());
+        std::vector<uint32_t> slot_of(num_handles, RenderGraph::kNoSlot);
+        for (uint32_t slot = 0; slot < num_slots; ++slot) {
+            slot_of[order[slot]] = slot;
+            if (slot == 0 || wave[order[slot]] != wave[order[slot - 1]]) next->waves.push_back(slot);
+        }
+        next->waves.push_back(num_slots);
+        for (auto& route : next->routes) {
+            route.slot = slot_of[route.synth];
+        }
+
+        next->mod_begin.assign(num_slots + 1, 0);
+        next->mod_lanes.assign(num_slots, RenderGraph::kNoSlot);
+        for (const auto& mod : mod_routes_) {
+            if (rendered[mod.target]) ++next->mod_begin[slot_of[mod.target] + 1];
+        }
+        uint32_t num_mod_lanes = 0;
+        for (uint32_t slot = 0; slot < num_slots; ++slot) {
+            if (next->mod_begin[slot + 1] > 0) {
+                next->mod_lanes[slot] = num_mod_lanes;
+                num_mod_lanes += kNumModParams;
+            }
+            next->mod_begin[slot + 1] += next->mod_begin[slot];
+        }
+        next->modulations.resize(next->mod_begin[num_slots]);
+        std::vector<uint32_t> cursor(next->mod_begin.begin(), next->mod_begin.end() - 1);
+        for (const auto& mod : mod_routes_) {
+            if (!rendered[mod.target]) continue;
+            next->modulations[cursor[slot_of[mod.target]]++] = {slot_of[mod.source], mod.param, static_cast<float>(mod.depth)};
+        }
+
+        next->oversampling.resize(num_slots);
+        for (uint32_t slot = 0; slot < num_slots; ++slot) {
+            next->oversampling[slot] = oversampling[order[slot]];
+        }
+        next->render_list = std::move(order);
+        next->slot_of = std::move(slot_of);
+        next->event_begin.assign(next->render_list.size() + 1, 0);
+        next->mod_buffers.allocate(num_mod_lanes, scratch_.max_frames());
+        next->synth_buffers.allocate(next->render_list.size(), scratch_.max_frames());
+        next->slot_active.assign(next->render_list.size(), 0);
+        RenderGraph* current = graph_.load();
+        if (scene_fade > 0 && current != nullptr) {
+            next->outgoing = std::shared_ptr<const RenderGraph>(current);
+            next->scene_fade = scene_fade;
+            next->scene_fade_id = next_scene_fade_id_++;
+        } else if (current != nullptr && current->outgoing && current->scene_fade_id != scene_faded_.load()) {
+            next->outgoing = current->outgoing;
+            next->scene_fade = current->scene_fade;
+            next->scene_fade_id = current->scene_fade_id;
+        }
+        RenderGraph* prev = graph_.exchange(next);
+        if (prev && prev != next->outgoing.get()) {
+            retired_graphs_.emplace_back(prev, callback_epoch_.load());
+            reaper_cv_.notify_one();
+        }
+    }
+
+    // Detaches the retired graphs the audio thread can no longer be reading.
+    // Must be called with control_mutex_ held; the caller deletes them after
+    // releasing it, since dropping a graph may free the last reference to a
+    // deleted Synth.
+    std::vector<RenderGraph*> _collect_retired() {
+        std::vector<RenderGraph*> reclaimable;
+        const uint64_t epoch = callback_epoch_.load();
+        auto it = std::remove_if(retired_graphs_.begin(), retired_graphs_.end(), [&](const auto& retired) {
+            if (retired.second % 2 == 0 || retired.second != epoch) {
+                reclaimable.push_back(retired.first);
+                return true;
+            }
+            return false;
+        });
+        retired_graphs_.erase(it, retired_graphs_.end());
+        return reclaimable;
+    }
+
+    // Frees whatever retired graphs and tables the audio thread has let go
+    // of. `lock` holds control_mutex_ and is released while deleting. Returns
+    // whether anything was freed.
+    bool _reclaim(std::unique_lock<std::mutex>& lock) {
+        std::vector<RenderGraph*> reclaimable = _collect_retired();
+        std::vector<const Wavetable*> tables;
+        for (const auto& synth : synth_slots_) {
+            if (synth) synth->_take_retired_tables(tables);
+        }
+        if (reclaimable.empty() && tables.empty()) return false;
+        lock.unlock();
+        for (RenderGraph* graph : reclaimable) delete graph;
+        for (const Wavetable* table : tables) delete table;
+        lock.lock();
+        return true;
+    }
+
+    // Must be called with control_mutex_ held. A table the same as `table`
+    // from the scene being built or a stored one, if there is one, so scenes
+    // share their copies.
+    std::shared_ptr<const Wavetable> _intern_table(std::shared_ptr<const Wavetable> table, const Scene& building) const {
+        auto find = [&](const Scene& scene) -> std::shared_ptr<const Wavetable> {
+            for (const auto& synth : scene.synths) {
+                if (synth.table && synth.table->same_source(*table)) return synth.table;
+            }
+            return nullptr;
+        };
+        if (auto match = find(building)) return match;
+        for (const auto& [name, scene] : scenes_) {
+            if (auto match = find(*scene)) return match;
+        }
+        return table;
+    }
+
+    // A detached synth in the state `entry` describes; its setters apply
+    // directly until it is attached.
+    std::shared_ptr<Synth> _build_scene_synth(const SceneSynth& entry) const {
+        auto synth = std::make_shared<Synth>(this->sample_rate_, std::make_unique<const Wavetable>(*entry.table), entry.voices);
+        synth->set_frequency(entry.frequency);
+        synth->set_amplitude(entry.amplitude);
+        synth->set_phase_offset(entry.phase_offset);
+        synth->set_position(entry.position);
+        synth->set_phase_mode(entry.phase_mode);
+        synth->set_resync_interval(entry.resync_seconds);
+        synth->set_band_limited(entry.band_limited);
+        synth->set_interpolation(entry.interpolation);
+        synth->set_envelope(entry.envelope[0], entry.envelope[1], entry.envelope[2], entry.envelope[3]);
+        if (entry.playing) synth->start();
+        return synth;
+    }
+
+    // Lets the commands queued so far reach their synths before a snapshot.
+    // A running stream gets one whole callback (or a quarter second, if it
+    // has stalled); an offline engine applies the ones that are due here,
+    // between renders.
+    void _settle_commands() {
+        if (stream_ == nullptr) {
+            std::lock_guard<std::mutex> offline(offline_mutex_);
+            _apply_due_commands();
+            return;
+        }
+        const uint64_t epoch = callback_epoch_.load();
+        const uint64_t settled = epoch + 2 + (epoch & 1);
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(250);
+        while (callback_epoch_.load() < settled && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
+    // The synth `command` is for, if `graph` has it. When it doesn't, the
+    // synth was deleted if its serial is older than the graph's next_serial,
+    // and otherwise was created after the graph was published: its commands
+    // are kept until a graph that has it comes along.
+    static Synth* _command_target(const RenderGraph& graph, const Command& command) {
+        Synth* synth = command.synth < graph.synths.size() ? graph.synths[command.synth] : nullptr;
+        return synth != nullptr && synth->serial_ == command.serial ? synth : nullptr;
+    }
+
+    // One attempt at queueing `commands` together. command_mutex_ is only held
+    // for the attempt, never across a wait, so a waiter that has released the
+    // GIL can't deadlock against a Python thread queueing behind it.
+    bool _try_post_commands(Command* commands, std::size_t count) {
+        std::lock_guard<std::mutex> lock(command_mutex_);
+        for (std::size_t i = 0; i < count; ++i) {
+            commands[i].seq = next_command_seq_ + i;
+        }
+        if (!commands_.try_push_all(commands, count)) return false;
+        next_command_seq_ += count;
+        return true;
+    }
+
+    // Offline engines, under offline_mutex_: stands in for the audio thread
+    // and applies every queued command that is due by the master clock.
+    void _apply_due_commands() {
+        callback_epoch_.fetch_add(1);
+        const RenderGraph* graph = graph_.load();
+        const uint64_t now = this->master_phase_.load(std::memory_order_relaxed);
+        Command command;
+        while (pending_commands_.size() < pending_commands_.capacity() && commands_.try_pop(command)) {
+            pending_commands_.push_back(command);
+        }
+        std::size_t kept = 0;
+        for (const Command& pending : pending_commands_) {
+            if (pending.time > now) {
+                pending_commands_[kept++] = pending;
+                continue;
+            }
+            Synth* synth = _command_target(*graph, pending);
+            if (synth != nullptr) {
+                synth->_apply(pending, now);
+            } else if (pending.serial >= graph->next_serial) {
+                pending_commands_[kept++] = pending;
+            }
+        }
+        pending_commands_.erase(pending_commands_.begin() + kept, pending_commands_.end());
+        callback_epoch_.fetch_add(1);
+    }
+
+    void _reaper_loop() {
+        std::unique_lock<std::mutex> lock(control_mutex_);
+        while (reaper_running_) {
+            if (_reclaim(lock)) continue;
+            // A graph retired mid-callback becomes reclaimable within one buffer, so poll
+            // briefly; otherwise often enough to keep up with table swaps from a clock action.
+            reaper_cv_.wait_for(lock, retired_graphs_.empty() ? std::chrono::milliseconds(50) : std::chrono::milliseconds(5));
+        }
+    }
+
+    // Audio thread: takes the commands that fall inside the block starting at
+    // `start` and sorts them by slot, time and enqueue order into
+    // block_events_. Commands for unrouted synths are applied here directly;
+    // routed ones are applied by _render_job at their offset.
+    void _collect_events(const RenderGraph& graph, uint64_t start, unsigned long frames) {
+        Command command;
+        while (pending_commands_.size() < pending_commands_.capacity() && commands_.try_pop(command)) {
+            pending_commands_.push_back(command);
+        }
+
+        block_events_.clear();
+        const uint64_t end = start + frames;
+        std::size_t kept = 0;
+        for (const Command& pending : pending_commands_) {
+            if (pending.time >= end) {
+                pending_commands_[kept++] = pending;
+                continue;
+            }
+            Synth* synth = _command_target(graph, pending);
+            if (synth == nullptr) {
+                if (pending.serial >= graph.next_serial) pending_commands_[kept++] = pending;
+                continue;
+            }
+            const auto offset = static_cast<uint32_t>(pending.time > start ? pending.time - start : 0);
+            block_events_.push_back({graph.slot_of[pending.synth], offset, pending});
+        }
+        pending_commands_.erase(pending_commands_.begin() + kept, pending_commands_.end());
+
+        std::sort(block_events_.begin(), block_events_.end(), [](const BlockEvent& a, const BlockEvent& b) {
+            if (a.slot != b.slot) return a.slot < b.slot;
+            if (a.offset != b.offset) return a.offset < b.offset;
+            return a.command.seq < b.command.seq;
+        });
+
+        std::fill(graph.event_begin.begin(), graph.event_begin.end(), 0);
+        const auto num_slots = static_cast<uint32_t>(graph.render_list.size());
+        for (const BlockEvent& event : block_events_) {
+            if (event.slot == RenderGraph::kNoSlot) {
+                graph.synths[event.command.synth]->_apply(event.command, start + event.offset);
+            } else {
+                ++graph.event_begin[event.slot + 1];
+            }
+        }
+        for (uint32_t slot = 0; slot < num_slots; ++slot) {
+            graph.event_begin[slot + 1] += graph.event_begin[slot];
+        }
+    }
+
+    // An `outgoing` graph is a scene being faded out: it takes no commands,
+    // doesn't move the master clock and isn't counted in render_cache_hits.
+    void _render_block(const RenderGraph& graph, unsigned long frames, bool outgoing = false) {
+        const uint64_t start = this->master_phase_.load(std::memory_order_relaxed);
+        if (outgoing) {
+            std::fill(graph.event_begin.begin(), graph.event_begin.end(), 0);
+        } else {
+            _collect_events(graph, start, frames);
+        }
+
+        // Every routed synth is rendered once into its slot buffer, however many
+        // patches use it; the patches then all mix from that buffer.
+        RenderJobContext context{&graph, block_events_.data(), frames, start, 0};
+        RenderWorkerPool* pool = pool_.load(std::memory_order_acquire);
+        const bool parallel = pool != nullptr && parallel_cooldown_ == 0;
+        bool missed = false;
+        for (std::size_t w = 0; w + 1 < graph.waves.size(); ++w) {
+            context.first_slot = graph.waves[w];
+            const uint32_t num_jobs = graph.waves[w + 1] - graph.waves[w];
+            // After a miss the rest of the block stays on the audio thread.
+            if (parallel && !missed && num_jobs > 1) {
+                missed = !pool->run(&AudioEngine::_render_job, &context, num_jobs, callback_deadline_);
+            } else {
+                for (uint32_t job = 0; job < num_jobs; ++job) {
+                    _render_job(&context, job);
+                }
+            }
+        }
+        if (missed) {
+            parallel_deadline_misses_.fetch_add(1, std::memory_order_relaxed);
+            parallel_cooldown_ = static_cast<unsigned long>(this->sample_rate_ / frames) + 1;
+        } else if (!parallel && parallel_cooldown_ > 0) {
+            --parallel_cooldown_;
+        }
+
+        for (float* lane : graph.mix_lanes) {
+            std::fill_n(lane, frames, 0.f);
+        }
+        const int* channels = graph.channels.data();
+        uint64_t cache_hits = 0;
+        for (const auto& route : graph.routes) {
+            if (!graph.slot_active[route.slot]) continue;
+            if (!route.first_use) ++cache_hits;
+            const float* synth_buffer = graph.synth_buffers.lane(route.slot);
+            for (uint32_t c = 0; c < route.num_channels; ++c) {
+                mix_accumulate(graph.mix_lanes[channels[route.first_channel + c]], synth_buffer, 1.f, frames);
+            }
+        }
+        // Mixed as a whole, so a bus transform costs the same however many
+        // synths feed it.
+        const uint32_t device_lanes = static_cast<uint32_t>(this->numOutputChannels_);
+        for (const auto& stage : graph.buses) {
+            float from[6], to[6];
+            stage.bus->_take_transform(from, to);
+            const float* x = graph.mix_lanes[device_lanes + stage.lanes];
+            const float* y = graph.mix_lanes[device_lanes + stage.lanes + 1];
+            mix_transform(graph.mix_lanes[stage.out_x], graph.mix_lanes[stage.out_y], x, y, from, to, frames);
+        }
+        if (cache_hits > 0 && !outgoing) render_cache_hits_.fetch_add(cache_hits, std::memory_order_relaxed);
+        if (!outgoing) this->master_phase_.store(start + frames, std::memory_order_relaxed);
+    }
+
+    // Renders a block of `graph`, crossfading from the scene it replaced while
+    // a recall's fade runs. Returns the gain to write the device lanes with:
+    // a faded block has both scenes' master volumes applied already.
+    float _render_scene(const RenderGraph& graph, unsigned long frames) {
+        const RenderGraph* outgoing = graph.outgoing.get();
+        const uint64_t start = this->master_phase_.load(std::memory_order_relaxed);
+        if (outgoing != nullptr && graph.scene_fade_id != scene_fade_id_) {
+            scene_fade_id_ = graph.scene_fade_id;
+            scene_fade_start_ = start;
+        }
+        const uint64_t done = start - scene_fade_start_;
+        if (outgoing == nullptr || done >= graph.scene_fade) {
+            if (outgoing != nullptr) scene_faded_.store(graph.scene_fade_id, std::memory_order_relaxed);
+            _render_block(graph, frames);
+            return graph.master_volume;
+        }
+        _render_block(*outgoing, frames, true);
+        for (int c = 0; c < this->numOutputChannels_; ++c) {
+            copy_with_gain(scene_fade_buffer_.lane(c), bus_lanes_[c], outgoing->master_volume, frames);
+        }
+        _render_block(graph, frames);
+        const auto faded = static_cast<unsigned long>(std::min<uint64_t>(frames, graph.scene_fade - done));
+        const float step = 1.f / static_cast<float>(graph.scene_fade);
+        for (int c = 0; c < this->numOutputChannels_; ++c) {
+            copy_with_gain(bus_lanes_[c], bus_lanes_[c], graph.master_volume, frames);
+            blend_from(bus_lanes_[c], scene_fade_buffer_.lane(c), faded, static_cast<float>(done) * step, step);
+        }
+        return 1.f;
+    }
 
-        for (const auto& name : patch_names_to_process) {
-            patches_.erase(name);
+    // Copies the bus to the host buffer at `offset` frames, applying the master volume.
+    void _write_output(void* outputBuffer, unsigned long offset, unsigned long frames, float gain) {
+        switch (output_format_) {
+        case SampleFormat::Int16: _write_quantized<2>(outputBuffer, offset, frames, gain); return;
+        case SampleFormat::Int24: _write_quantized<3>(outputBuffer, offset, frames, gain); return;
+        case SampleFormat::Int32: _write_quantized<4>(outputBuffer, offset, frames, gain); return;
+        case SampleFormat::Float32: break;
         }
-
-        for (const auto& synth_name : synth_names_to_process) {
-            std::vector<std::string> related_patches_to_delete;
-            for (const auto& [patch_name, patch_ptr] : patches_) {
-                if (patch_ptr->get_synth_name() == synth_name) {
-                    related_patches_to_delete.push_back(patch_name);
-                }
+        if (output_non_interleaved_) {
+            auto** out = static_cast<float**>(outputBuffer);
+            for (int c = 0; c < this->numOutputChannels_; ++c) {
+                copy_with_gain(out[c] + offset, bus_lanes_[c], gain, frames);
             }
-            for (const auto& patch_name : related_patches_to_delete) {
-                patches_.erase(patch_name);
-            }
-            synths_.erase(synth_name);
+        } else {
+            auto* out = static_cast<float*>(outputBuffer) + offset * this->numOutputChannels_;
+            interleave_with_gain(out, bus_lanes_.data(), this->numOutputChannels_, frames, gain);
+        }
+    }
+
+    template <int Bytes>
+    void _write_quantized(void* outputBuffer, unsigned long offset, unsigned long frames, float gain) {
+        // 32-bit output is already finer than the float mix, so it isn't dithered.
+        TpdfDither* dither = output_dither_ && Bytes < 4 ? &dither_ : nullptr;
+        const int channels = this->numOutputChannels_;
+        for (int c = 0; c < channels; ++c) {
+            uint8_t* out = output_non_interleaved_
+                ? static_cast<uint8_t**>(outputBuffer)[c] + offset * Bytes
+                : static_cast<uint8_t*>(outputBuffer) + (offset * channels + c) * Bytes;
+            const std::size_t stride = output_non_interleaved_ ? Bytes : static_cast<std::size_t>(channels) * Bytes;
+            quantize_with_gain<Bytes>(out, stride, bus_lanes_[c], gain, frames, dither);
         }
     }
 
@@ -213,31 +4339,39 @@ private:
                    const PaStreamCallbackTimeInfo* timeInfo,
                    PaStreamCallbackFlags statusFlags) {
         
-        _cleanup();
+        [[maybe_unused]] AudioThreadScope audio_thread_scope;
+        callback_epoch_.fetch_add(1);
+        const RenderGraph* graph = graph_.load();
 
-        auto* out = static_cast<float*>(outputBuffer);
-        std::fill_n(out, framesPerBuffer * this->numOutputChannels_, 0.0f);
-        
-        std::vector<float> mono_buffer(framesPerBuffer);
-        std::lock_guard<std::recursive_mutex> lock(engine_mutex_);
-        
-        for (const auto& [patch_name, patch_ptr] : patches_) {
-            auto synth_it = synths_.find(patch_ptr->get_synth_name());
-            if (synth_it != synths_.end() && synth_it->second->is_playing()) {
-                std::shared_ptr<Synth> synth = synth_it->second;
-                synth->set_master_phase(this->master_phase_);
-                synth->render(mono_buffer.data(), framesPerBuffer, this->master_phase_);
-                
-                for (int channel_index : patch_ptr->get_channels()) {
-                    if (channel_index < this->numOutputChannels_) {
-                        for (unsigned long frame = 0; frame < framesPerBuffer; ++frame) {
-                            out[frame * this->numOutputChannels_ + channel_index] += mono_buffer[frame] * this->master_volume;
-                        }
-                    }
-                }
+        // Offline renders have no buffer period to meet, so the workers never
+        // time out there.
+        const auto callback_start = std::chrono::steady_clock::now();
+        const double buffer_seconds = static_cast<double>(framesPerBuffer) / this->sample_rate_;
+        callback_deadline_ = stream_ == nullptr ? std::chrono::steady_clock::time_point::max()
+            : callback_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(buffer_seconds * parallel_deadline_fraction_.load(std::memory_order_relaxed)));
+
+        SharedOutputTap* tap = output_tap_.load(std::memory_order_acquire);
+        CaptureRing* capture = capture_ring_.load(std::memory_order_acquire);
+        const unsigned long block_frames = static_cast<unsigned long>(scratch_.max_frames());
+        for (unsigned long offset = 0; offset < framesPerBuffer; offset += block_frames) {
+            const unsigned long frames = std::min(block_frames, framesPerBuffer - offset);
+            const uint64_t block_start = master_phase_.load(std::memory_order_relaxed);
+            const float gain = _render_scene(*graph, frames);
+            _write_output(outputBuffer, offset, frames, gain);
+            if (tap != nullptr) {
+                const double dac_time = timeInfo != nullptr && timeInfo->outputBufferDacTime > 0.0
+                    ? timeInfo->outputBufferDacTime + static_cast<double>(offset) / this->sample_rate_ : 0.0;
+                tap->publish(bus_lanes_.data(), frames, gain, block_start, dac_time);
             }
+            if (capture != nullptr) capture->write(bus_lanes_.data(), frames, gain);
         }
-        this->master_phase_ += framesPerBuffer;
+        if (timeInfo != nullptr && timeInfo->outputBufferDacTime > 0.0) {
+            output_latency_.store(timeInfo->outputBufferDacTime - timeInfo->currentTime, std::memory_order_relaxed);
+        }
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - callback_start);
+        callback_stats_.record(static_cast<uint64_t>(elapsed.count()), static_cast<uint64_t>(buffer_seconds * 1e6), statusFlags);
+        callback_epoch_.fetch_add(1);
         return paContinue;
     }
 
@@ -249,166 +4383,1296 @@ private:
         return static_cast<AudioEngine*>(userData)->paCallback(inputBuffer, outputBuffer, framesPerBuffer, timeInfo, statusFlags);
     }
 
+    explicit AudioEngine(int numChannels) : numOutputChannels_(numChannels) {}
+
+    static PaSampleFormat _pa_sample_format(SampleFormat format) {
+        switch (format) {
+        case SampleFormat::Int32: return paInt32;
+        case SampleFormat::Int24: return paInt24;
+        case SampleFormat::Int16: return paInt16;
+        case SampleFormat::Float32: break;
+        }
+        return paFloat32;
+    }
+
+    // Fills in the host-API specific stream info the config asks for, or
+    // returns nullptr when it asks for none. Options the device's host API
+    // (or this PortAudio build) can't honour are an error rather than being
+    // silently dropped.
+    void* _host_api_stream_info(const PaDeviceInfo& device, const StreamConfig& config) {
+        if (config.channel_selectors.empty() && config.mac_core_flags == 0) return nullptr;
+        const PaHostApiInfo* host = Pa_GetHostApiInfo(device.hostApi);
+        const PaHostApiTypeId type = host ? host->type : paInDevelopment;
+        if (!config.channel_selectors.empty() && static_cast<int>(config.channel_selectors.size()) != numOutputChannels_) {
+            throw std::runtime_error("channel_selectors needs one device channel per engine channel");
+        }
+        for (int channel : config.channel_selectors) {
+            if (channel < 0 || channel >= device.maxOutputChannels) {
+                throw std::runtime_error("channel_selectors entry " + std::to_string(channel) + " is not an output of this device");
+            }
+        }
+#ifdef OSCAR_PA_MAC_CORE
+        if (type == paCoreAudio) {
+            // CoreAudio's output map runs the other way: one entry per device
+            // output, holding the stream channel it plays (or -1).
+            channel_map_.clear();
+            if (!config.channel_selectors.empty()) {
+                channel_map_.assign(device.maxOutputChannels, -1);
+                for (int c = 0; c < numOutputChannels_; ++c) channel_map_[config.channel_selectors[c]] = c;
+            }
+            PaMacCore_SetupStreamInfo(&mac_core_info_, config.mac_core_flags);
+            if (!channel_map_.empty()) {
+                PaMacCore_SetupChannelMap(&mac_core_info_, channel_map_.data(), static_cast<unsigned long>(channel_map_.size()));
+            }
+            return &mac_core_info_;
+        }
+#endif
+#ifdef OSCAR_PA_ASIO
+        if (type == paASIO && config.mac_core_flags == 0) {
+            channel_map_.assign(config.channel_selectors.begin(), config.channel_selectors.end());
+            asio_info_ = PaAsioStreamInfo{sizeof(PaAsioStreamInfo), paASIO, 1, paAsioUseChannelSelectors, channel_map_.data()};
+            return &asio_info_;
+        }
+#endif
+        (void)type;
+        throw std::runtime_error("Host-API options are not supported for host '" + std::string(host ? host->name : "unknown")
+                                 + "': channel_selectors needs ASIO or CoreAudio, mac_core_flags needs CoreAudio.");
+    }
+
+    void _allocate_render_state(unsigned long max_frames) {
+        scratch_.allocate(numOutputChannels_, max_frames);
+        scene_fade_buffer_.allocate(numOutputChannels_, max_frames);
+        pending_commands_.reserve(commands_.capacity());
+        block_events_.reserve(commands_.capacity());
+        for (int c = 0; c < numOutputChannels_; ++c) {
+            bus_lanes_.push_back(scratch_.lane(c));
+        }
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        _publish_graph();
+    }
+
+    void _start_reaper() {
+        reaper_running_ = true;
+        reaper_ = std::thread(&AudioEngine::_reaper_loop, this);
+    }
+
 public:
-    AudioEngine(int deviceIndex, int numChannels) : numOutputChannels_(numChannels) {
+    AudioEngine(int deviceIndex, int numChannels, const StreamConfig& config = StreamConfig())
+        : numOutputChannels_(numChannels) {
         const PaDeviceInfo* deviceInfo = Pa_GetDeviceInfo(deviceIndex);
         if (deviceInfo == nullptr) throw std::runtime_error("Invalid device index");
         if (numChannels > deviceInfo->maxOutputChannels) {
             throw std::runtime_error("Device does not support requested number of output channels");
         }
+        if (config.sample_rate < 0.0 || config.suggested_latency < 0.0) {
+            throw std::runtime_error("Sample rate and latency must not be negative");
+        }
         
-        this->sample_rate_ = deviceInfo->defaultSampleRate;
-        py::print("Device reports default sample rate of: ", this->sample_rate_);
+        this->sample_rate_ = config.sample_rate > 0.0 ? config.sample_rate : deviceInfo->defaultSampleRate;
+        py::print("Device reports default sample rate of: ", deviceInfo->defaultSampleRate);
 
         PaStreamParameters outputParameters;
         outputParameters.device = deviceIndex;
         outputParameters.channelCount = numChannels;
-        outputParameters.sampleFormat = paFloat32;
-        outputParameters.suggestedLatency = Pa_GetDeviceInfo(deviceIndex)->defaultLowOutputLatency;
-        outputParameters.hostApiSpecificStreamInfo = nullptr;
+        const PaSampleFormat format = _pa_sample_format(config.sample_format);
+        outputParameters.sampleFormat = format | paNonInterleaved;
+        outputParameters.suggestedLatency = config.suggested_latency > 0.0 ? config.suggested_latency : deviceInfo->defaultLowOutputLatency;
+        outputParameters.hostApiSpecificStreamInfo = _host_api_stream_info(*deviceInfo, config);
+
+        // Hand the planar bus straight to hosts that take non-interleaved
+        // buffers (ASIO, CoreAudio); otherwise interleave it ourselves.
+        if (Pa_IsFormatSupported(nullptr, &outputParameters, this->sample_rate_) != paFormatIsSupported) {
+            outputParameters.sampleFormat = format;
+        }
+        const PaError supported = Pa_IsFormatSupported(nullptr, &outputParameters, this->sample_rate_);
+        if (supported != paFormatIsSupported) {
+            throw std::runtime_error("Device '" + std::string(deviceInfo->name) + "' cannot play " + std::to_string(numChannels)
+                                     + " channels at " + std::to_string(std::lround(this->sample_rate_)) + " Hz: " + Pa_GetErrorText(supported));
+        }
+        output_non_interleaved_ = (outputParameters.sampleFormat & paNonInterleaved) != 0;
+        output_format_ = config.sample_format;
+        output_dither_ = config.dither;
 
+        frames_per_buffer_ = config.frames_per_buffer;
         pa_check_error(
             Pa_OpenStream(&this->stream_, nullptr, &outputParameters, this->sample_rate_, 
-                          paFramesPerBufferUnspecified, paNoFlag, paCallbackAdapter, this),
+                          frames_per_buffer_ > 0 ? frames_per_buffer_ : paFramesPerBufferUnspecified,
+                          // Integer output is clipped and dithered here already.
+                          output_format_ == SampleFormat::Float32 ? paNoFlag : paClipOff | paDitherOff,
+                          paCallbackAdapter, this),
             "Failed to open PortAudio stream"
         );
+
+        // Without a fixed buffer size the host picks its own, so size the
+        // scratch from the latency it actually negotiated.
+        const PaStreamInfo* streamInfo = Pa_GetStreamInfo(this->stream_);
+        unsigned long max_frames = kMinBlockFrames;
+        const unsigned long wanted_frames = std::max(frames_per_buffer_, streamInfo != nullptr
+            ? static_cast<unsigned long>(std::ceil(streamInfo->outputLatency * this->sample_rate_)) : 0ul);
+        while (max_frames < wanted_frames && max_frames < kMaxBlockFrames) max_frames *= 2;
+        _allocate_render_state(max_frames);
+
         pa_check_error(Pa_StartStream(this->stream_), "Failed to start PortAudio stream");
-        py::print("PortAudio stream started on '", deviceInfo->name, "' with ", numChannels, " channels.");
+        _start_reaper();
+        py::print("PortAudio stream started on '", deviceInfo->name, "' with ", numChannels, " channels at ",
+                  this->sample_rate_, " Hz, ", streamInfo ? streamInfo->outputLatency * 1000.0 : 0.0, " ms output latency.");
+    }
+
+    // Headless engine: no PortAudio stream. The same render graph runs on the
+    // calling thread whenever render() or render_to_file() asks for frames,
+    // as fast as the CPU allows.
+    static std::unique_ptr<AudioEngine> offline(double sample_rate, int num_channels, unsigned long block_frames) {
+        if (sample_rate <= 0.0) throw std::runtime_error("Offline engine needs a positive sample rate");
+        if (num_channels <= 0) throw std::runtime_error("Offline engine needs at least one output channel");
+        std::unique_ptr<AudioEngine> engine(new AudioEngine(num_channels));
+        engine->sample_rate_ = sample_rate;
+        engine->_allocate_render_state(std::clamp(block_frames, kMinBlockFrames, kMaxBlockFrames));
+        engine->_start_reaper();
+        py::print("Offline engine started at ", sample_rate, " Hz with ", num_channels, " channels.");
+        return engine;
     }
 
     ~AudioEngine() {
+        // Input threads post commands, so they go first.
+        input_.reset();
         if (stream_) {
             Pa_StopStream(stream_);
             Pa_CloseStream(stream_);
         }
+        delete pool_.exchange(nullptr);
+        delete output_tap_.exchange(nullptr);
+        capture_ring_.store(nullptr);
+        if (reaper_.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(control_mutex_);
+                reaper_running_ = false;
+            }
+            reaper_cv_.notify_one();
+            reaper_.join();
+        }
+        // The stream is closed, so nothing can be holding a graph any more.
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        for (auto& patch : patch_slots_) {
+            if (patch) patch->engine_ = nullptr;
+        }
+        for (auto& bus : bus_slots_) {
+            if (bus) bus->engine_ = nullptr;
+        }
+        for (auto& synth : synth_slots_) {
+            if (synth) synth->engine_ = nullptr;
+        }
+        delete graph_.exchange(nullptr);
+        for (auto& retired : retired_graphs_) {
+            delete retired.first;
+        }
+        retired_graphs_.clear();
         py::print("AudioEngine instance destroyed. Stream stopped and closed.");
     }
 
-    std::shared_ptr<Synth> get_or_create_synth(const std::string& name, py::array_t<float> table) {
-        std::lock_guard<std::recursive_mutex> lock(engine_mutex_);
-        std::vector<float> table_vec(table.data(), table.data() + table.size());
-        auto it = synths_.find(name);
-        if (it != synths_.end()) {
-            it->second->update_wavetable(table_vec);
+    std::shared_ptr<Synth> get_or_create_synth(const std::string& name, const TableArray& table) {
+        return get_or_create_synth(name, make_wavetable(table));
+    }
+    std::shared_ptr<Synth> get_or_create_poly_synth(const std::string& name, const TableArray& table, unsigned voices) {
+        if (voices == 0 || voices > kMaxVoices) {
+            throw std::runtime_error("A polyphonic synth needs 1 to " + std::to_string(kMaxVoices) + " voices.");
+        }
+        return get_or_create_synth(name, make_wavetable(table), voices);
+    }
+    // `voices` > 0 creates a polyphonic synth with that many voices.
+    std::shared_ptr<Synth> get_or_create_synth(const std::string& name, std::unique_ptr<const Wavetable> wavetable, unsigned voices = 0) {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        Handle handle = _find_synth(name);
+        if (handle != kNoHandle) {
+            const auto& synth = synth_slots_[handle];
+            if (synth->num_voices_ != voices) {
+                // The voice pool is never reallocated under the audio thread.
+                throw std::runtime_error("Synth '" + name + "' already exists with " + std::to_string(synth->num_voices_) + " voices; delete it to change its polyphony.");
+            }
+            synth->install_wavetable(std::move(wavetable));
             py::print("Synth '", name, "' already exists.");
-            return it->second;
+            return synth;
         } else {
             py::print("Creating new wavetable synth with name: '", name, "'");
-            auto new_synth = std::make_shared<Synth>(this->sample_rate_, std::move(table_vec));
-            synths_[name] = new_synth;
+            auto new_synth = std::make_shared<Synth>(this->sample_rate_, std::move(wavetable), voices);
+            handle = _allocate_slot(synth_slots_, free_synth_handles_, new_synth);
+            new_synth->handle_ = handle;
+            new_synth->serial_ = next_synth_serial_++;
+            new_synth->engine_ = this;
+            synth_handles_[name] = handle;
+            _publish_graph();
             return new_synth;
         }
     }
 
-    std::shared_ptr<Patch> get_or_create_patch(const std::string& patch_name, const std::string& synth_name, std::vector<int> channels) {
-        std::lock_guard<std::recursive_mutex> lock(engine_mutex_);
-        if (synths_.find(synth_name) == synths_.end()) {
+    // With a bus, `channels` are the bus's lanes (0 = X, 1 = Y).
+    std::shared_ptr<Patch> get_or_create_patch(const std::string& patch_name, const std::string& synth_name, std::vector<int> channels, const std::string& bus = "") {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        const Handle synth_handle = _find_synth(synth_name);
+        if (synth_handle == kNoHandle) {
             throw std::runtime_error("Cannot create patch: synth with name '" + synth_name + "' does not exist.");
         }
+        const Handle bus_handle = _resolve_bus(bus, "Cannot create patch");
+
+        std::shared_ptr<Patch> patch;
+        auto it = patch_handles_.find(patch_name);
+        if (it != patch_handles_.end()) {
+            patch = patch_slots_[it->second];
+            patch->channels_ = std::move(channels);
+        } else {
+            patch = std::make_shared<Patch>(synth_name, std::move(channels));
+            patch->engine_ = this;
+            patch->handle_ = _allocate_slot(patch_slots_, free_patch_handles_, patch);
+            patch_handles_[patch_name] = patch->handle_;
+        }
+        patch->synth_name_ = synth_name;
+        patch->synth_handle_ = synth_handle;
+        patch->bus_name_ = bus;
+        patch->bus_handle_ = bus_handle;
+        _publish_graph();
+        return patch;
+    }
+
+    // Called by Patch setters so edits made through a Patch handle are
+    // published to the audio thread like any other graph change.
+    void update_patch(Patch& patch, const std::string& synth_name, const std::vector<int>& channels, const std::string& bus) {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        if (patch.engine_ != this) {
+            // Deleted patch: keep the edit locally, it has nothing to render.
+            patch.synth_name_ = synth_name;
+            patch.channels_ = channels;
+            patch.bus_name_ = bus;
+            return;
+        }
+        const Handle synth_handle = _find_synth(synth_name);
+        if (synth_handle == kNoHandle) {
+            throw std::runtime_error("Cannot patch to synth '" + synth_name + "': it does not exist.");
+        }
+        const Handle bus_handle = _resolve_bus(bus, "Cannot patch into bus");
+        patch.synth_name_ = synth_name;
+        patch.synth_handle_ = synth_handle;
+        patch.channels_ = channels;
+        patch.bus_name_ = bus;
+        patch.bus_handle_ = bus_handle;
+        _publish_graph();
+    }
 
-        auto it = patches_.find(patch_name);
-        if (it != patches_.end()) {
-            it->second->set_synth_name(synth_name);
-            it->second->set_channels(channels);
-            return it->second;
+    // `channels` are the device channels X and Y go to; a bus with a parent
+    // mixes into the parent's X and Y instead.
+    std::shared_ptr<Bus> get_or_create_bus(const std::string& name, std::vector<int> channels, const std::string& parent = "") {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        if (name.empty()) throw std::runtime_error("Cannot create a bus with an empty name.");
+        const Handle parent_handle = _resolve_bus(parent, "Cannot create bus '" + name + "'");
+        std::shared_ptr<Bus> bus;
+        auto it = bus_handles_.find(name);
+        if (it != bus_handles_.end()) {
+            bus = bus_slots_[it->second];
+            if (_bus_reaches(parent_handle, bus->handle_)) {
+                throw std::runtime_error("Cannot route bus '" + name + "' into '" + parent + "': it would create a loop.");
+            }
+            bus->channels_ = std::move(channels);
         } else {
-            auto new_patch = std::make_shared<Patch>(synth_name, channels);
-            patches_[patch_name] = new_patch;
-            return new_patch;
+            bus = std::make_shared<Bus>(std::move(channels));
+            bus->engine_ = this;
+            bus->handle_ = _allocate_slot(bus_slots_, free_bus_handles_, bus);
+            bus_handles_[name] = bus->handle_;
+        }
+        bus->parent_name_ = parent;
+        bus->parent_handle_ = parent_handle;
+        _publish_graph();
+        return bus;
+    }
+
+    // Called by Bus setters, like update_patch.
+    void update_bus(Bus& bus, const std::string& parent, const std::vector<int>& channels) {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        if (bus.engine_ != this) {
+            bus.parent_name_ = parent;
+            bus.channels_ = channels;
+            return;
+        }
+        const Handle parent_handle = _resolve_bus(parent, "Cannot route bus");
+        if (_bus_reaches(parent_handle, bus.handle_)) {
+            throw std::runtime_error("Cannot route bus into '" + parent + "': it would create a loop.");
         }
+        bus.parent_name_ = parent;
+        bus.parent_handle_ = parent_handle;
+        bus.channels_ = channels;
+        _publish_graph();
+    }
+
+    void set_bus_oversampling(Bus& bus, unsigned factor) {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        bus.oversampling_ = factor;
+        if (bus.engine_ == this) _publish_graph();
+    }
+
+    // Patches into the bus are deleted with it, as with delete_synth; buses
+    // that mixed into it go straight to their device channels instead.
+    void delete_bus(const std::string& name) {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        auto it = bus_handles_.find(name);
+        if (it == bus_handles_.end()) return;
+        const Handle handle = it->second;
+        bus_handles_.erase(it);
+
+        for (auto patch_it = patch_handles_.begin(); patch_it != patch_handles_.end();) {
+            if (patch_slots_[patch_it->second]->bus_handle_ == handle) {
+                _remove_patch(patch_it->second);
+                patch_it = patch_handles_.erase(patch_it);
+            } else {
+                ++patch_it;
+            }
+        }
+        for (auto& child : bus_slots_) {
+            if (child && child->parent_handle_ == handle) {
+                child->parent_handle_ = kNoHandle;
+                child->parent_name_.clear();
+            }
+        }
+        bus_slots_[handle]->handle_ = kNoHandle;
+        bus_slots_[handle]->engine_ = nullptr;
+        bus_slots_[handle].reset();
+        free_bus_handles_.push_back(handle);
+        _publish_graph();
+    }
+
+    std::vector<std::string> list_buses() {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        std::vector<std::string> names;
+        for (const auto& [name, handle] : bus_handles_) {
+            names.push_back(name);
+        }
+        return names;
     }
 
     void delete_synth(const std::string& name) {
-        std::lock_guard<std::recursive_mutex> lock(engine_mutex_);
-        synth_names_to_delete_.push_back(name);
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        auto it = synth_handles_.find(name);
+        if (it == synth_handles_.end()) return;
+        const Handle handle = it->second;
+        synth_handles_.erase(it);
+
+        for (auto patch_it = patch_handles_.begin(); patch_it != patch_handles_.end();) {
+            if (patch_slots_[patch_it->second]->synth_handle_ == handle) {
+                _remove_patch(patch_it->second);
+                patch_it = patch_handles_.erase(patch_it);
+            } else {
+                ++patch_it;
+            }
+        }
+        mod_routes_.erase(std::remove_if(mod_routes_.begin(), mod_routes_.end(), [&](const ModRoute& mod) {
+            return mod.source == handle || mod.target == handle;
+        }), mod_routes_.end());
+        // Commands still queued for it are dropped by the audio thread, which
+        // won't find its serial in the new graph.
+        synth_slots_[handle]->handle_ = kNoHandle;
+        synth_slots_[handle]->engine_ = nullptr;
+        synth_slots_[handle].reset();
+        free_synth_handles_.push_back(handle);
+        _publish_graph();
     }
 
     void delete_patch(const std::string& name) {
-        std::lock_guard<std::recursive_mutex> lock(engine_mutex_);
-        patch_names_to_delete_.push_back(name);
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        auto it = patch_handles_.find(name);
+        if (it == patch_handles_.end()) return;
+        _remove_patch(it->second);
+        patch_handles_.erase(it);
+        _publish_graph();
+    }
+
+    // Adds `depth` times the output of synth `source` to `param` of synth
+    // `target`, per sample: Hz for frequency, cycles for phase offset. Setting
+    // depth 0 removes the route. Modulation chains may not loop back.
+    void modulate(const std::string& source, const std::string& target, ModParam param, double depth) {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        const Handle source_handle = _find_synth(source);
+        const Handle target_handle = _find_synth(target);
+        if (source_handle == kNoHandle || target_handle == kNoHandle) {
+            throw std::runtime_error("Cannot modulate '" + target + "' from '" + source + "': both synths must exist.");
+        }
+        auto it = std::find_if(mod_routes_.begin(), mod_routes_.end(), [&](const ModRoute& mod) {
+            return mod.source == source_handle && mod.target == target_handle && mod.param == param;
+        });
+        if (depth == 0.0) {
+            if (it == mod_routes_.end()) return;
+            mod_routes_.erase(it);
+        } else if (it != mod_routes_.end()) {
+            it->depth = depth;
+        } else {
+            if (source_handle == target_handle || _modulation_reaches(target_handle, source_handle)) {
+                throw std::runtime_error("Cannot modulate '" + target + "' from '" + source + "': it would create a modulation loop.");
+            }
+            mod_routes_.push_back({source_handle, target_handle, param, depth});
+        }
+        _publish_graph();
+    }
+
+    // (source, target, param, depth) for every modulation route.
+    std::vector<std::tuple<std::string, std::string, ModParam, double>> list_modulations() {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        std::vector<std::string> names(synth_slots_.size());
+        for (const auto& [name, handle] : synth_handles_) {
+            names[handle] = name;
+        }
+        std::vector<std::tuple<std::string, std::string, ModParam, double>> routes;
+        for (const auto& mod : mod_routes_) {
+            routes.emplace_back(names[mod.source], names[mod.target], mod.param, mod.depth);
+        }
+        return routes;
     }
 
     std::vector<std::string> list_synths() {
-        std::lock_guard<std::recursive_mutex> lock(engine_mutex_);
+        std::lock_guard<std::mutex> lock(control_mutex_);
         std::vector<std::string> names;
-        for (const auto& [name, synth_ptr] : synths_) {
+        for (const auto& [name, handle] : synth_handles_) {
             names.push_back(name);
         }
         return names;
     }
 
+    // Lookups by name that never create anything; null (None) if missing.
+    std::shared_ptr<Synth> find_synth(const std::string& name) {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        const Handle handle = _find_synth(name);
+        return handle == kNoHandle ? nullptr : synth_slots_[handle];
+    }
+    std::shared_ptr<Patch> find_patch(const std::string& name) {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        auto it = patch_handles_.find(name);
+        return it == patch_handles_.end() ? nullptr : patch_slots_[it->second];
+    }
+    std::shared_ptr<Bus> find_bus(const std::string& name) {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        auto it = bus_handles_.find(name);
+        return it == bus_handles_.end() ? nullptr : bus_slots_[it->second];
+    }
+
     std::vector<std::string> list_patches() {
-        std::lock_guard<std::recursive_mutex> lock(engine_mutex_);
+        std::lock_guard<std::mutex> lock(control_mutex_);
         std::vector<std::string> names;
-        for (const auto& [name, patch_ptr] : patches_) {
+        for (const auto& [name, handle] : patch_handles_) {
             names.push_back(name);
         }
         return names;
     }
 
     void set_master_volume(float volume) {
-        std::lock_guard<std::recursive_mutex> lock(engine_mutex_);
+        std::lock_guard<std::mutex> lock(control_mutex_);
         master_volume = volume;
+        _publish_graph();
     }
 
     float get_master_volume() {
-        std::lock_guard<std::recursive_mutex> lock(engine_mutex_);
+        std::lock_guard<std::mutex> lock(control_mutex_);
         return master_volume;
     }
 
+    // Snapshots every synth (table, parameters and playing state, as the
+    // audio thread last applied them), bus, patch and modulation route, and
+    // the master volume, as scene `name`. Changes queued just before are
+    // let through first. Voices that are sounding and running glides aren't
+    // kept.
+    void store_scene(const std::string& name) {
+        if (name.empty()) throw std::runtime_error("Cannot store a scene with an empty name.");
+        py::gil_scoped_release release;
+        _settle_commands();
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        auto scene = std::make_shared<Scene>();
+        scene->master_volume = master_volume;
+        std::vector<std::string> names(synth_slots_.size());
+        for (const auto& [synth_name, handle] : synth_handles_) {
+            const Synth& synth = *synth_slots_[handle];
+            names[handle] = synth_name;
+            SceneSynth entry;
+            entry.name = synth_name;
+            entry.table = _intern_table(synth._copy_table(), *scene);
+            entry.voices = synth.num_voices_;
+            entry.playing = synth.is_playing();
+            entry.frequency = synth.get_frequency();
+            entry.amplitude = synth.get_amplitude();
+            entry.phase_offset = synth.get_phase_offset();
+            entry.position = synth.get_position();
+            entry.phase_mode = synth.get_phase_mode();
+            entry.resync_seconds = synth.get_resync_interval();
+            entry.band_limited = synth.get_band_limited();
+            entry.interpolation = synth.get_interpolation();
+            std::tie(entry.envelope[0], entry.envelope[1], entry.envelope[2], entry.envelope[3]) = synth.get_envelope();
+            scene->synths.push_back(std::move(entry));
+        }
+        for (const auto& [bus_name, handle] : bus_handles_) {
+            const Bus& bus = *bus_slots_[handle];
+            SceneBus entry{bus_name, bus.parent_name_, bus.channels_, bus.oversampling_};
+            for (int k = 0; k < Bus::kNumParams; ++k) entry.transform[k] = bus._read(k);
+            scene->buses.push_back(std::move(entry));
+        }
+        for (const auto& [patch_name, handle] : patch_handles_) {
+            const Patch& patch = *patch_slots_[handle];
+            scene->patches.push_back({patch_name, patch.synth_name_, patch.bus_name_, patch.channels_});
+        }
+        for (const auto& mod : mod_routes_) {
+            scene->modulations.push_back({names[mod.source], names[mod.target], mod.param, mod.depth});
+        }
+        scenes_[name] = std::move(scene);
+    }
+
+    // Replaces everything the engine plays with scene `name`, switching on a
+    // buffer boundary, or crossfading from the current mix over `fade`
+    // frames. Synths, patches and buses are new objects, so handles held on
+    // the old ones go stale (the Python wrappers look theirs up again); a
+    // synth that replaces one of the same name keeps its handle, so queued
+    // changes, apply_batch handles and input bindings carry over to it.
+    void recall_scene(const std::string& name, uint64_t fade = 0) {
+        py::gil_scoped_release release;
+        std::shared_ptr<const Scene> scene;
+        {
+            std::lock_guard<std::mutex> lock(control_mutex_);
+            auto it = scenes_.find(name);
+            if (it == scenes_.end()) throw std::runtime_error("Scene '" + name + "' does not exist.");
+            scene = it->second;
+        }
+        // Copying the tables is most of the work, so it happens unlocked.
+        std::vector<std::shared_ptr<Synth>> synths;
+        for (const auto& entry : scene->synths) synths.push_back(_build_scene_synth(entry));
+
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        std::map<std::string, std::pair<Handle, uint64_t>> replaced;  // handle and serial, by name
+        for (const auto& [synth_name, handle] : synth_handles_) replaced[synth_name] = {handle, synth_slots_[handle]->serial_};
+        for (auto& synth : synth_slots_) {
+            if (synth) { synth->engine_ = nullptr; synth->handle_ = kNoHandle; }
+        }
+        for (auto& patch : patch_slots_) {
+            if (patch) { patch->engine_ = nullptr; patch->handle_ = kNoHandle; }
+        }
+        for (auto& bus : bus_slots_) {
+            if (bus) { bus->engine_ = nullptr; bus->handle_ = kNoHandle; }
+        }
+
+        synth_slots_.assign(synth_slots_.size(), nullptr);
+        synth_handles_.clear();
+        for (std::size_t i = 0; i < synths.size(); ++i) {
+            auto it = replaced.find(scene->synths[i].name);
+            if (it == replaced.end()) continue;
+            synths[i]->handle_ = it->second.first;
+            synths[i]->serial_ = it->second.second;
+            synth_slots_[it->second.first] = synths[i];
+        }
+        free_synth_handles_.clear();
+        for (Handle h = static_cast<Handle>(synth_slots_.size()); h-- > 0;) {
+            if (!synth_slots_[h]) free_synth_handles_.push_back(h);
+        }
+        for (std::size_t i = 0; i < synths.size(); ++i) {
+            auto& synth = synths[i];
+            if (synth->handle_ == kNoHandle) {
+                synth->handle_ = _allocate_slot(synth_slots_, free_synth_handles_, synth);
+                synth->serial_ = next_synth_serial_++;
+            }
+            synth->engine_ = this;
+            synth_handles_[scene->synths[i].name] = synth->handle_;
+        }
+
+        bus_slots_.clear();
+        bus_handles_.clear();
+        free_bus_handles_.clear();
+        for (const auto& entry : scene->buses) {
+            auto bus = std::make_shared<Bus>(entry.channels);
+            const float* t = entry.transform;
+            bus->set_transform(t[0], t[1], t[2], t[3], t[4], t[5], t[6]);
+            bus->oversampling_ = entry.oversampling;
+            bus->engine_ = this;
+            bus->handle_ = _allocate_slot(bus_slots_, free_bus_handles_, bus);
+            bus_handles_[entry.name] = bus->handle_;
+        }
+        for (const auto& entry : scene->buses) {
+            const auto& bus = bus_slots_[bus_handles_[entry.name]];
+            bus->parent_name_ = entry.parent;
+            bus->parent_handle_ = _resolve_bus(entry.parent, "Cannot recall scene '" + name + "'");
+        }
+
+        patch_slots_.clear();
+        patch_handles_.clear();
+        free_patch_handles_.clear();
+        for (const auto& entry : scene->patches) {
+            auto patch = std::make_shared<Patch>(entry.synth, entry.channels);
+            patch->engine_ = this;
+            patch->handle_ = _allocate_slot(patch_slots_, free_patch_handles_, patch);
+            patch->synth_handle_ = _find_synth(entry.synth);
+            patch->bus_name_ = entry.bus;
+            patch->bus_handle_ = _resolve_bus(entry.bus, "Cannot recall scene '" + name + "'");
+            patch_handles_[entry.name] = patch->handle_;
+        }
+
+        mod_routes_.clear();
+        for (const auto& mod : scene->modulations) {
+            mod_routes_.push_back({_find_synth(mod.source), _find_synth(mod.target), mod.param, mod.depth});
+        }
+        master_volume = scene->master_volume;
+        _publish_graph(fade);
+    }
+
+    void delete_scene(const std::string& name) {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        scenes_.erase(name);
+    }
+
+    std::vector<std::string> list_scenes() {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        std::vector<std::string> names;
+        for (const auto& [name, scene] : scenes_) {
+            names.push_back(name);
+        }
+        return names;
+    }
+
+    // Writes every stored scene to `path` (see write_scenes for the format).
+    void save_scenes(const std::string& path) {
+        py::gil_scoped_release release;
+        std::vector<uint8_t> bytes;
+        {
+            std::lock_guard<std::mutex> lock(control_mutex_);
+            bytes = write_scenes(scenes_);
+        }
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr) throw std::runtime_error("Cannot open '" + path + "' for writing.");
+        const bool written = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+        if (std::fclose(file) != 0 || !written) throw std::runtime_error("Failed writing scene file '" + path + "'.");
+    }
+
+    // Adds the scenes in `path`, replacing stored scenes of the same name,
+    // and returns their names. Nothing is recalled. Tables are shared with
+    // the scenes already stored where they match.
+    std::vector<std::string> load_scenes(const std::string& path) {
+        py::gil_scoped_release release;
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr) throw std::runtime_error("Cannot open '" + path + "' for reading.");
+        std::vector<uint8_t> bytes;
+        uint8_t chunk[1 << 16];
+        for (std::size_t n; (n = std::fread(chunk, 1, sizeof(chunk), file)) > 0;) bytes.insert(bytes.end(), chunk, chunk + n);
+        const bool failed = std::ferror(file) != 0;
+        std::fclose(file);
+        if (failed) throw std::runtime_error("Failed reading scene file '" + path + "'.");
+        SceneMap loaded = read_scenes(bytes, kMaxVoices);
+
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        std::vector<std::string> names;
+        for (auto& [name, scene] : loaded) {
+            auto shared = std::make_shared<Scene>(*scene);
+            for (auto& synth : shared->synths) synth.table = _intern_table(synth.table, *shared);
+            scenes_[name] = std::move(shared);
+            names.push_back(name);
+        }
+        return names;
+    }
+
+    // Renders synths on `num_threads` extra worker threads (0 turns the pool
+    // off). `deadline` is the fraction of the buffer period the workers get:
+    // past it they take no more jobs, the rest of the buffer is rendered on
+    // the audio thread, and so are the next second's worth of buffers. A job a
+    // worker had already started is still waited for.
+    void set_render_threads(unsigned num_threads, double deadline) {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        parallel_deadline_fraction_.store(std::clamp(deadline, 0.05, 1.0));
+        RenderWorkerPool* current = pool_.load();
+        if (num_threads == (current ? current->size() : 0u)) return;
+        RenderWorkerPool* next = num_threads > 0 ? new RenderWorkerPool(num_threads) : nullptr;
+        RenderWorkerPool* prev = pool_.exchange(next);
+        _wait_for_callback();
+        delete prev;
+    }
+
+    // Publishes the final mix into the shared-memory ring `name`, holding at
+    // least `seconds` of audio (see SharedOutputTap for the layout). An empty
+    // name closes the tap.
+    void set_output_tap(const std::string& name, double seconds) {
+        std::unique_ptr<SharedOutputTap> next;
+        if (!name.empty()) {
+            uint64_t capacity = 2 * scratch_.max_frames();
+            while (static_cast<double>(capacity) < seconds * sample_rate_) capacity *= 2;
+            next = std::make_unique<SharedOutputTap>(name, numOutputChannels_, capacity, sample_rate_);
+        }
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        SharedOutputTap* prev = output_tap_.exchange(next.release());
+        _wait_for_callback();
+        delete prev;
+    }
+
+    // Keeps the last `seconds` of output for read_output(); 0 turns capture off.
+    void set_capture(double seconds) {
+        std::shared_ptr<CaptureRing> next;
+        if (seconds > 0.0) {
+            const auto capacity = std::max<std::size_t>(scratch_.max_frames(), static_cast<std::size_t>(std::ceil(seconds * sample_rate_)));
+            next = std::make_shared<CaptureRing>(numOutputChannels_, capacity);
+        }
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        capture_ring_.store(next.get());
+        _wait_for_callback();
+        capture_ = std::move(next);
+    }
+
+    // The latest `frames` frames of output as a read-only (channels, frames)
+    // view into the capture ring, without copying. The view shows exactly
+    // those frames until the engine renders capacity - frames more; copy it
+    // to keep it longer.
+    py::array_t<float> read_output(std::size_t frames) {
+        std::shared_ptr<CaptureRing> ring;
+        {
+            std::lock_guard<std::mutex> lock(control_mutex_);
+            ring = capture_;
+        }
+        if (!ring) throw std::runtime_error("Output capture is off; call set_capture(seconds) first.");
+        if (frames > ring->capacity()) {
+            throw std::runtime_error("Only " + std::to_string(ring->capacity()) + " frames are captured; asked for " + std::to_string(frames));
+        }
+        const float* first = ring->lane(0) + ring->latest(frames);
+        auto* owner = new std::shared_ptr<CaptureRing>(ring);
+        py::capsule base(owner, [](void* p) { delete static_cast<std::shared_ptr<CaptureRing>*>(p); });
+        py::array_t<float> view(
+            std::vector<py::ssize_t>{static_cast<py::ssize_t>(ring->channels()), static_cast<py::ssize_t>(frames)},
+            std::vector<py::ssize_t>{static_cast<py::ssize_t>(ring->lane_stride() * sizeof(float)), static_cast<py::ssize_t>(sizeof(float))},
+            first, base);
+        view.attr("flags").attr("writeable") = false;
+        return view;
+    }
+
+    std::string get_output_tap() {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        SharedOutputTap* tap = output_tap_.load();
+        return tap ? tap->name() : std::string();
+    }
+
+    unsigned get_render_threads() {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        RenderWorkerPool* pool = pool_.load();
+        return pool ? pool->size() : 0;
+    }
+
+    uint64_t render_deadline_misses() const { return parallel_deadline_misses_.load(); }
+
+    // Patch mixes served from a synth already rendered for another patch in the same block.
+    uint64_t render_cache_hits() const { return render_cache_hits_.load(); }
+
+    // Snapshot of the callback telemetry. Times are in microseconds; the
+    // budget is the last buffer's period, which the render time must stay
+    // under to avoid an underflow.
+    py::dict stats() const {
+        const CallbackStats& s = callback_stats_;
+        const uint64_t callbacks = s.callbacks();
+        py::dict out;
+        out["callbacks"] = callbacks;
+        out["output_underflows"] = s.underflows();
+        out["output_overflows"] = s.overflows();
+        out["overruns"] = s.overruns();
+        out["budget_us"] = s.budget_micros();
+        out["mean_us"] = callbacks ? static_cast<double>(s.total_micros()) / static_cast<double>(callbacks) : 0.0;
+        out["p50_us"] = s.percentile(0.5);
+        out["p99_us"] = s.percentile(0.99);
+        out["max_us"] = s.max_micros();
+        out["cpu_load"] = stream_ ? Pa_GetStreamCpuLoad(stream_) : 0.0;
+        out["output_latency"] = output_latency_.load(std::memory_order_relaxed);
+        out["render_deadline_misses"] = parallel_deadline_misses_.load();
+        out["render_cache_hits"] = render_cache_hits_.load();
+        return out;
+    }
+
+    void reset_stats() { callback_stats_.reset(); }
+
+    // What the host actually granted, which may differ from what was asked.
+    py::dict stream_info() const {
+        py::dict out;
+        out["sample_rate"] = sample_rate_;
+        out["frames_per_buffer"] = frames_per_buffer_;
+        out["non_interleaved"] = output_non_interleaved_;
+        out["sample_format"] = output_format_;
+        const PaStreamInfo* info = stream_ ? Pa_GetStreamInfo(stream_) : nullptr;
+        out["output_latency"] = info ? info->outputLatency : 0.0;
+        if (info) out["sample_rate"] = info->sampleRate;
+        return out;
+    }
+
+    // Queues commands for the audio thread as one transaction: they all
+    // become visible to the callback at once. If the queue is full, an
+    // offline engine applies the commands that are already due (as its next
+    // render would) and a running stream gets a moment, without the GIL, to
+    // drain it. Throws if there is still no room.
+    void post_commands(Command* commands, std::size_t count) {
+        if (count > commands_.capacity()) {
+            throw std::runtime_error("Command batch of " + std::to_string(count) + " exceeds the queue capacity of "
+                                     + std::to_string(commands_.capacity()) + ".");
+        }
+        if (_try_post_commands(commands, count)) return;
+        if (stream_ == nullptr) {
+            // try_lock: a render on another thread is draining the queue anyway,
+            // and apply_batch gets here holding control_mutex_, which render takes.
+            std::unique_lock<std::mutex> offline(offline_mutex_, std::try_to_lock);
+            if (offline.owns_lock()) {
+                _apply_due_commands();
+                if (_try_post_commands(commands, count)) return;
+                throw std::runtime_error("Command queue is full of changes scheduled ahead: render() the offline engine to reach them.");
+            }
+        }
+        bool posted = false;
+        without_gil([&] {
+            for (int attempt = 0; attempt < 1000 && !(posted = _try_post_commands(commands, count)); ++attempt) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        });
+        if (!posted) {
+            throw std::runtime_error("Command queue is full: the audio stream is not consuming commands.");
+        }
+    }
+
+    void post_command(Command command) { post_commands(&command, 1); }
+
+    // Queues a command only if there is room right now, for threads that must
+    // never wait on the audio thread. Returns whether it was queued.
+    bool try_post_command(Command command) { return _try_post_commands(&command, 1); }
+
+    using HandleArray = py::array_t<uint32_t, py::array::c_style | py::array::forcecast>;
+    using ParamArray = py::array_t<int32_t, py::array::c_style | py::array::forcecast>;
+    using ValueArray = py::array_t<double, py::array::c_style | py::array::forcecast>;
+    using TimeArray = py::array_t<uint64_t, py::array::c_style | py::array::forcecast>;
+
+    // Applies a frame of parameter changes in one call: row i sets param
+    // params[i] (a Command::Type) of the synth with handle handles[i] to
+    // values[i], at sample times[i] (or the next block if times is None).
+    // Every row is validated before any is queued, and they are all queued
+    // as one transaction, so a batch for the next block lands on one buffer.
+    void apply_batch(const HandleArray& handles, const ParamArray& params, const ValueArray& values, std::optional<TimeArray> times) {
+        const auto count = static_cast<std::size_t>(handles.size());
+        if (static_cast<std::size_t>(params.size()) != count || static_cast<std::size_t>(values.size()) != count
+            || (times && static_cast<std::size_t>(times->size()) != count)) {
+            throw std::runtime_error("apply_batch: handles, params, values and times must have the same length.");
+        }
+        const uint32_t* handle_data = handles.data();
+        const int32_t* param_data = params.data();
+        const double* value_data = values.data();
+        const uint64_t* time_data = times ? times->data() : nullptr;
+
+        py::gil_scoped_release release;
+        std::vector<Command> batch(count);
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        for (std::size_t i = 0; i < count; ++i) {
+            const Handle handle = handle_data[i];
+            if (handle >= synth_slots_.size() || !synth_slots_[handle]) {
+                throw std::runtime_error("apply_batch: no synth with handle " + std::to_string(handle) + ".");
+            }
+            if (param_data[i] < 0 || param_data[i] > static_cast<int32_t>(Command::Type::SetPosition)) {
+                throw std::runtime_error("apply_batch: unknown param id " + std::to_string(param_data[i]) + ".");
+            }
+            batch[i] = Command{static_cast<Command::Type>(param_data[i]), handle, synth_slots_[handle]->serial_,
+                               time_data ? time_data[i] : 0, 0, value_data[i]};
+        }
+        post_commands(batch.data(), batch.size());
+    }
+
+    double get_sample_rate() const { return sample_rate_; }
+
+    // Offline engines: renders the next `frames` frames, interleaved, into
+    // `out` on the calling thread. The mutex keeps the command queue
+    // single-consumer when several threads render at once. Retired graphs and
+    // tables are freed after each call, since a tight render loop can swap
+    // tables faster than the reaper polls.
+    void render_into(float* out, unsigned long frames) {
+        if (stream_ != nullptr) {
+            throw std::runtime_error("This engine is driving an audio device; only offline engines can render on demand.");
+        }
+        if (frames == 0) return;
+        std::lock_guard<std::mutex> lock(offline_mutex_);
+        paCallback(nullptr, out, frames, nullptr, 0);
+        std::unique_lock<std::mutex> control(control_mutex_);
+        _reclaim(control);
+    }
+
+    // Offline engines: the next `frames` frames as a (frames, channels) array.
+    py::array_t<float> render(unsigned long frames) {
+        py::array_t<float> out(std::vector<py::ssize_t>{static_cast<py::ssize_t>(frames), numOutputChannels_});
+        float* data = out.mutable_data();
+        py::gil_scoped_release release;
+        render_into(data, frames);
+        return out;
+    }
+
+    // Offline engines: renders the next `frames` frames straight to `path`,
+    // as 32-bit float WAV ("wav") or headerless interleaved float32 ("raw").
+    void render_to_file(const std::string& path, unsigned long frames, const std::string& format) {
+        if (format != "wav" && format != "raw") {
+            throw std::runtime_error("Unsupported output format '" + format + "': use 'wav' or 'raw'.");
+        }
+        py::gil_scoped_release release;
+        AudioFileWriter writer(path, format == "wav", static_cast<unsigned>(numOutputChannels_), sample_rate_);
+        std::vector<float> block(static_cast<std::size_t>(scratch_.max_frames()) * numOutputChannels_);
+        for (unsigned long done = 0; done < frames;) {
+            const unsigned long n = std::min<unsigned long>(scratch_.max_frames(), frames - done);
+            render_into(block.data(), n);
+            writer.write(block.data(), n);
+            done += n;
+        }
+        writer.finish();
+    }
+
+    // Master clock position, in samples, of the next block to be rendered.
+    uint64_t sample_time() const { return master_phase_.load(std::memory_order_relaxed); }
+
     void stop_all() {
-        std::lock_guard<std::recursive_mutex> lock(engine_mutex_);
-        for (const auto& [name, synth_ptr] : synths_) {
-            synth_ptr->stop();
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        for (const auto& synth : synth_slots_) {
+            if (synth) synth->stop();
+        }
+    }
+
+    // MIDI and OSC input. Bound messages are turned into commands on the
+    // input threads; everything else goes to the input callback, if any.
+    void open_midi_input(int port) { _input().open_midi(port); }
+    void open_osc_input(int port, const std::string& host) {
+        if (port <= 0 || port > 65535) throw std::runtime_error("OSC port must be between 1 and 65535.");
+        _input().open_osc(port, host);
+    }
+    void close_input() {
+        if (input_) {
+            input_->close_osc();
+            input_->close_midi();
+        }
+    }
+    static std::vector<std::string> midi_input_ports() { return ControlInput::midi_ports(); }
+
+    // Controller `cc` (0-127) sets `param` of `synth`, scaled onto [lo, hi].
+    void bind_midi_cc(int cc, const std::string& synth, Command::Type param, int channel, double lo, double hi) {
+        if (cc < 0 || cc > 127) throw std::runtime_error("MIDI controller numbers run from 0 to 127.");
+        _bind(InputBinding::Source::ControlChange, cc, "", synth, param, channel, lo, hi);
+    }
+    void bind_midi_pitch_bend(const std::string& synth, Command::Type param, int channel, double lo, double hi) {
+        _bind(InputBinding::Source::PitchBend, 0, "", synth, param, channel, lo, hi);
+    }
+    // Notes play a polyphonic synth.
+    void bind_midi_notes(const std::string& synth, int channel) {
+        _bind(InputBinding::Source::Notes, 0, "", synth, Command::Type::NoteOn, channel, 0.0, 1.0);
+    }
+    // The first numeric argument of messages to `address` sets `param`, as lo + (hi - lo) * x.
+    void bind_osc(const std::string& address, const std::string& synth, Command::Type param, double lo, double hi) {
+        if (address.empty() || address[0] != '/') throw std::runtime_error("OSC addresses start with '/'.");
+        _bind(InputBinding::Source::Osc, 0, address, synth, param, -1, lo, hi);
+    }
+    void clear_input_bindings() {
+        if (input_) input_->clear_bindings();
+    }
+    // Called as callback(kind, address, values) for unbound input: ('midi', '', bytes) or ('osc', address, args).
+    void set_input_callback(std::optional<py::function> callback) {
+        _input().set_callback(callback ? std::move(*callback) : py::function());
+    }
+
+    // Feeds one raw MIDI message or OSC packet through the bindings, as if it
+    // had arrived on an input (for scripting and testing without a device).
+    void inject_midi(const std::vector<uint8_t>& message) {
+        py::gil_scoped_release release;
+        _input().handle_midi(message.data(), message.size());
+    }
+    void inject_osc(const py::bytes& packet) {
+        const std::string data = packet;
+        py::gil_scoped_release release;
+        _input().handle_osc(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+    }
+
+private:
+    ControlInput& _input() {
+        std::lock_guard<std::mutex> lock(control_mutex_);
+        if (!input_) input_ = std::make_unique<ControlInput>(this);
+        return *input_;
+    }
+
+    void _bind(InputBinding::Source source, int number, const std::string& address, const std::string& synth_name,
+               Command::Type param, int channel, double lo, double hi) {
+        if (channel < -1 || channel > 15) throw std::runtime_error("MIDI channels run from 0 to 15 (or -1 for any).");
+        if (source != InputBinding::Source::Notes && param > Command::Type::SetPosition) {
+            throw std::runtime_error("Only Param values can be bound to input.");
+        }
+        InputBinding binding{source, channel, number, address, kNoHandle, 0, param, lo, hi};
+        {
+            std::lock_guard<std::mutex> lock(control_mutex_);
+            const Handle handle = _find_synth(synth_name);
+            if (handle == kNoHandle) throw std::runtime_error("No synth named '" + synth_name + "' to bind input to.");
+            if (source == InputBinding::Source::Notes && !synth_slots_[handle]->voices_) {
+                throw std::runtime_error("Synth '" + synth_name + "' is not polyphonic, so it can't play MIDI notes.");
+            }
+            binding.synth = handle;
+            binding.serial = synth_slots_[handle]->serial_;
         }
+        _input().add_binding(std::move(binding));
     }
 };
 
 
+void ControlInput::_post(const InputBinding& binding, Command::Type type, double value, float velocity) {
+    // Input that finds the queue full is dropped rather than stalling this
+    // thread (and everyone waiting on mutex_).
+    engine_->try_post_command(Command{type, binding.synth, binding.serial, 0, 0, value, 0, RampShape::Linear, velocity});
+}
+
+
+void Synth::_post(Command::Type type, double value, uint64_t at, uint64_t duration, RampShape shape, float velocity) {
+    const Command command{type, handle_, serial_, at, 0, value, duration, shape, velocity};
+    if (engine_ == nullptr) { _apply(command, at); return; }
+    engine_->post_command(command);
+}
+
+void Synth::start(uint64_t at) { _post(Command::Type::Start, 0.0, at); }
+void Synth::stop(uint64_t at) { _post(Command::Type::Stop, 0.0, at); }
+void Synth::set_frequency(double freq, uint64_t at) { _post(Command::Type::SetFrequency, freq, at); }
+void Synth::set_amplitude(double amp, uint64_t at) { _post(Command::Type::SetAmplitude, amp, at); }
+void Synth::set_phase_offset(double offset, uint64_t at) { _post(Command::Type::SetPhaseOffset, offset, at); }
+void Synth::smooth_set_frequency(double new_freq, uint64_t at) { _post(Command::Type::SmoothSetFrequency, new_freq, at); }
+void Synth::ramp_frequency(double target, uint64_t samples, RampShape shape, uint64_t at) {
+    _post(Command::Type::RampFrequency, target, at, samples, shape);
+}
+void Synth::ramp_amplitude(double target, uint64_t samples, RampShape shape, uint64_t at) {
+    _post(Command::Type::RampAmplitude, target, at, samples, shape);
+}
+void Synth::ramp_phase_offset(double target, uint64_t samples, uint64_t at) {
+    _post(Command::Type::RampPhaseOffset, target, at, samples);
+}
+void Synth::set_position(double position, uint64_t at) { _post(Command::Type::SetPosition, position, at); }
+void Synth::_require_voices(const char* action) const {
+    if (!voices_) throw std::runtime_error(std::string("Cannot ") + action + ": the synth is not polyphonic.");
+}
+void Synth::note_on(double note, float velocity, uint64_t at) {
+    _require_voices("play a note");
+    _post(Command::Type::NoteOn, note, at, 0, RampShape::Linear, std::min(std::max(velocity, 0.f), 1.f));
+}
+void Synth::note_off(double note, uint64_t at) {
+    _require_voices("release a note");
+    _post(Command::Type::NoteOff, note, at);
+}
+void Synth::all_notes_off(uint64_t at) {
+    _require_voices("release notes");
+    _post(Command::Type::AllNotesOff, 0.0, at);
+}
+void Synth::ramp_position(double target, uint64_t samples, uint64_t at) {
+    _post(Command::Type::RampPosition, target, at, samples);
+}
+
+
+void Patch::set_synth_name(const std::string& name) {
+    if (engine_ == nullptr) { synth_name_ = name; return; }
+    engine_->update_patch(*this, name, channels_, bus_name_);
+}
+
+void Patch::set_channels(const std::vector<int>& channels) {
+    if (engine_ == nullptr) { channels_ = channels; return; }
+    engine_->update_patch(*this, synth_name_, channels, bus_name_);
+}
+
+void Patch::set_bus(const std::string& name) {
+    if (engine_ == nullptr) { bus_name_ = name; return; }
+    engine_->update_patch(*this, synth_name_, channels_, name);
+}
+
+void Bus::set_parent(const std::string& name) {
+    if (engine_ == nullptr) { parent_name_ = name; return; }
+    engine_->update_bus(*this, name, channels_);
+}
+
+void Bus::set_channels(const std::vector<int>& channels) {
+    if (engine_ == nullptr) { channels_ = channels; return; }
+    engine_->update_bus(*this, parent_name_, channels);
+}
+
+void Bus::set_oversampling(unsigned factor) {
+    if (factor != 1 && factor != 2 && factor != 4 && factor != kMaxOversampling) {
+        throw std::runtime_error("Oversampling must be 1, 2, 4 or 8.");
+    }
+    if (engine_ == nullptr) { oversampling_ = factor; return; }
+    engine_->set_bus_oversampling(*this, factor);
+}
+
+
 PYBIND11_MODULE(oscar_server, m) {
     m.doc() = "A live-coding audio engine with named synths and patches";
     
-    m.def("initialize", &initialize, "Initializes the PortAudio library. Must be called first.");
+    m.def("initialize", &initialize, py::arg("jack_client_name") = "", "Initializes the PortAudio library. Must be called first. jack_client_name names the engine's JACK client.");
     m.def("terminate", &terminate, "Terminates the PortAudio library. Must be called last.");
     m.def("get_device_details", &getDeviceDetails, "Gets a list of all available audio devices.");
+    m.def("simd_backend", &simd_backend, "Name of the SIMD oscillator kernel selected for this CPU.");
+    m.def("rt_allocation_count", &rt_allocation_count, "Number of heap allocations made on the audio thread (-1 unless built with OSCAR_RT_ALLOC_CHECK).");
 
     py::class_<DeviceInfo>(m, "DeviceInfo")
         .def_readonly("index", &DeviceInfo::index)
         .def_readonly("name", &DeviceInfo::name)
         .def_readonly("max_output_channels", &DeviceInfo::maxOutputChannels)
+        .def_readonly("host_api", &DeviceInfo::hostApi)
+        .def_readonly("default_sample_rate", &DeviceInfo::defaultSampleRate)
+        .def_readonly("default_low_latency", &DeviceInfo::defaultLowOutputLatency)
+        .def_readonly("default_high_latency", &DeviceInfo::defaultHighOutputLatency)
         .def("__repr__", [](const DeviceInfo &d) {
             return "<DeviceInfo " + std::to_string(d.index) + ": '" + d.name + "' ("
-                   + std::to_string(d.maxOutputChannels) + " channels)>";
+                   + std::to_string(d.maxOutputChannels) + " channels, " + d.hostApi + ")>";
         });
 
+    py::enum_<SampleFormat>(m, "SampleFormat", "Host buffer sample format; integer formats are clipped and dithered by the engine.")
+        .value("float32", SampleFormat::Float32)
+        .value("int32", SampleFormat::Int32)
+        .value("int24", SampleFormat::Int24)
+        .value("int16", SampleFormat::Int16);
+
+    py::class_<StreamConfig>(m, "StreamConfig", "Output stream settings for AudioEngine; zeros leave the choice to the device or host.")
+        .def(py::init<>())
+        .def_readwrite("sample_rate", &StreamConfig::sample_rate)
+        .def_readwrite("frames_per_buffer", &StreamConfig::frames_per_buffer)
+        .def_readwrite("suggested_latency", &StreamConfig::suggested_latency)
+        .def_readwrite("channel_selectors", &StreamConfig::channel_selectors)
+        .def_readwrite("mac_core_flags", &StreamConfig::mac_core_flags)
+        .def_readwrite("sample_format", &StreamConfig::sample_format)
+        .def_readwrite("dither", &StreamConfig::dither);
+
+    py::enum_<Command::Type>(m, "Param", "Parameter ids for AudioEngine.apply_batch.")
+        .value("start", Command::Type::Start)
+        .value("stop", Command::Type::Stop)
+        .value("frequency", Command::Type::SetFrequency)
+        .value("smooth_frequency", Command::Type::SmoothSetFrequency)
+        .value("amplitude", Command::Type::SetAmplitude)
+        .value("phase_offset", Command::Type::SetPhaseOffset)
+        .value("position", Command::Type::SetPosition);
+
+    py::enum_<Interpolation>(m, "Interpolation", "How a synth reads its table between entries.")
+        .value("none", Interpolation::None)
+        .value("linear", Interpolation::Linear)
+        .value("hermite", Interpolation::Hermite)
+        .value("sinc", Interpolation::Sinc);
+
+    py::enum_<ModParam>(m, "ModParam")
+        .value("frequency", ModParam::Frequency)
+        .value("amplitude", ModParam::Amplitude)
+        .value("phase_offset", ModParam::PhaseOffset);
+
+    py::enum_<RampShape>(m, "RampShape")
+        .value("linear", RampShape::Linear)
+        .value("exponential", RampShape::Exponential);
+
+    py::enum_<PhaseMode>(m, "PhaseMode")
+        .value("absolute", PhaseMode::Absolute)
+        .value("accumulator", PhaseMode::Accumulator);
+
+    py::enum_<WaveShape>(m, "WaveShape")
+        .value("sine", WaveShape::Sine)
+        .value("saw", WaveShape::Saw)
+        .value("square", WaveShape::Square)
+        .value("triangle", WaveShape::Triangle);
+    m.def("wave_table", &wave_table, py::arg("shape"), py::arg("size") = 2048, "Returns a generated sine, saw, square or triangle table as a float32 array.");
+
     py::class_<Synth, std::shared_ptr<Synth>>(m, "Synth")
-        .def("start", &Synth::start)
-        .def("stop", &Synth::stop)
+        .def("handle", &Synth::handle, "Dense id of the synth, for AudioEngine.apply_batch.")
+        .def("start", &Synth::start, py::arg("at") = 0)
+        .def("stop", &Synth::stop, py::arg("at") = 0)
         .def("is_playing", &Synth::is_playing)
-        .def("set_frequency", &Synth::set_frequency)
+        .def("set_frequency", &Synth::set_frequency, py::arg("freq"), py::arg("at") = 0)
         .def("get_frequency", &Synth::get_frequency)
-        .def("set_amplitude", &Synth::set_amplitude)
+        .def("set_amplitude", &Synth::set_amplitude, py::arg("amp"), py::arg("at") = 0)
         .def("get_amplitude", &Synth::get_amplitude)
-        .def("update_wavetable", &Synth::update_wavetable)
-        .def("set_phase_offset", &Synth::set_phase_offset)
+        .def("update_wavetable", &Synth::update_wavetable, py::arg("wavetable"), py::arg("crossfade") = 0, "Swaps in a new wavetable (or a 2-D frames x samples wavetable set), crossfading over `crossfade` samples.")
+        .def("set_phase_offset", &Synth::set_phase_offset, py::arg("offset"), py::arg("at") = 0)
         .def("get_phase_offset", &Synth::get_phase_offset)
-        .def("smooth_set_frequency", &Synth::smooth_set_frequency);
+        .def("smooth_set_frequency", &Synth::smooth_set_frequency, py::arg("freq"), py::arg("at") = 0)
+        .def("set_phase_mode", &Synth::set_phase_mode, py::arg("mode"))
+        .def("get_phase_mode", &Synth::get_phase_mode)
+        .def("set_resync_interval", &Synth::set_resync_interval, py::arg("seconds"), "Seconds between accumulator re-syncs to the master clock (0 disables).")
+        .def("get_resync_interval", &Synth::get_resync_interval)
+        .def("ramp_frequency", &Synth::ramp_frequency, py::arg("target"), py::arg("samples"), py::arg("shape") = RampShape::Linear, py::arg("at") = 0, "Glides the frequency to target over `samples` samples, phase-continuously.")
+        .def("ramp_amplitude", &Synth::ramp_amplitude, py::arg("target"), py::arg("samples"), py::arg("shape") = RampShape::Linear, py::arg("at") = 0, "Glides the amplitude to target over `samples` samples.")
+        .def("ramp_phase_offset", &Synth::ramp_phase_offset, py::arg("target"), py::arg("samples"), py::arg("at") = 0, "Glides the phase offset to target over `samples` samples.")
+        .def("set_position", &Synth::set_position, py::arg("position"), py::arg("at") = 0, "Sets the frame of a wavetable set to play; fractional positions blend neighbouring frames.")
+        .def("get_position", &Synth::get_position)
+        .def("ramp_position", &Synth::ramp_position, py::arg("target"), py::arg("samples"), py::arg("at") = 0, "Morphs through a wavetable set to position target over `samples` samples, per sample.")
+        .def("get_num_frames", &Synth::get_num_frames, "Number of frames in the synth's wavetable set (1 for a single table).")
+        .def("note_on", &Synth::note_on, py::arg("note"), py::arg("velocity") = 1.f, py::arg("at") = 0, "Polyphonic synths: starts a note (MIDI note number, fractions allowed) at velocity 0 to 1.")
+        .def("note_off", &Synth::note_off, py::arg("note"), py::arg("at") = 0, "Polyphonic synths: releases a note.")
+        .def("all_notes_off", &Synth::all_notes_off, py::arg("at") = 0, "Polyphonic synths: releases every note.")
+        .def("set_envelope", &Synth::set_envelope, py::arg("attack"), py::arg("decay"), py::arg("sustain"), py::arg("release"), "Polyphonic synths: sets the ADSR envelope (times in seconds, sustain level 0 to 1) for new notes.")
+        .def("get_envelope", &Synth::get_envelope)
+        .def("get_polyphony", &Synth::get_polyphony, "Number of voices (0 for a single-oscillator synth).")
+        .def("get_active_voices", &Synth::get_active_voices, "Number of voices currently sounding.")
+        .def("generate_wave", &Synth::generate_wave, py::arg("shape"), py::arg("size") = 2048, py::arg("crossfade") = 0, "Builds a sine, saw, square or triangle table in the engine and installs it.")
+        .def("generate_partials", &Synth::generate_partials, py::arg("amplitudes"), py::arg("phases") = std::vector<double>(), py::arg("size") = 2048, py::arg("normalize") = true, py::arg("crossfade") = 0, "Builds and installs a sum of harmonics 1..n at the given amplitudes and phases (in cycles).")
+        .def("generate_path", &Synth::generate_path, py::arg("points"), py::arg("axis"), py::arg("closed") = true, py::arg("size") = 2048, py::arg("crossfade") = 0, "Installs the X (axis 0) or Y (axis 1) coordinate of a (points, 2) polyline traced at constant speed.")
+        .def("morph_wavetables", &Synth::morph_wavetables, py::arg("a"), py::arg("b"), py::arg("t"), py::arg("size") = 2048, py::arg("normalize") = true, py::arg("crossfade") = 0, "Installs (1 - t) * a + t * b, blended in the engine.")
+        .def("set_band_limited", &Synth::set_band_limited, py::arg("enabled"), "Renders from band-limited copies of the table so high notes don't alias (on by default).")
+        .def("get_band_limited", &Synth::get_band_limited)
+        .def("set_interpolation", &Synth::set_interpolation, py::arg("mode"), "Sets how the table is read between entries: none, linear (default), hermite or sinc.")
+        .def("get_interpolation", &Synth::get_interpolation);
     
     py::class_<Patch, std::shared_ptr<Patch>>(m, "Patch")
         .def("get_channels", &Patch::get_channels)
         .def("get_synth_name", &Patch::get_synth_name)
         .def("set_synth_name", &Patch::set_synth_name)
-        .def("set_channels", &Patch::set_channels);
+        .def("set_channels", &Patch::set_channels)
+        .def("get_bus_name", &Patch::get_bus_name)
+        .def("set_bus", &Patch::set_bus, py::arg("name"), "Routes the patch into a bus's X/Y lanes, or straight to device channels with an empty name.");
+
+    py::class_<Bus, std::shared_ptr<Bus>>(m, "Bus")
+        .def("get_channels", &Bus::get_channels)
+        .def("set_channels", &Bus::set_channels, py::arg("channels"), "Sets the device channels the bus's X and Y go to when it has no parent.")
+        .def("get_parent", &Bus::get_parent)
+        .def("set_parent", &Bus::set_parent, py::arg("name"), "Mixes the bus into another bus, or to its device channels with an empty name.")
+        .def("set_gain", &Bus::set_gain, py::arg("gain"), "Sets the bus gain, ramped over the next block.")
+        .def("get_gain", &Bus::get_gain)
+        .def("set_matrix", &Bus::set_matrix, py::arg("a"), py::arg("b"), py::arg("c"), py::arg("d"), "Sets the 2x2 X/Y matrix: x' = a*x + b*y, y' = c*x + d*y.")
+        .def("get_matrix", &Bus::get_matrix)
+        .def("set_translate", &Bus::set_translate, py::arg("x"), py::arg("y"), "Sets the offset added to X and Y after the matrix.")
+        .def("get_translate", &Bus::get_translate)
+        .def("set_transform", &Bus::set_transform, py::arg("gain"), py::arg("a"), py::arg("b"), py::arg("c"), py::arg("d"), py::arg("x"), py::arg("y"), "Sets gain, matrix and offset together, so they change on the same block.")
+        .def("set_oversampling", &Bus::set_oversampling, py::arg("factor"), "Renders the synths mixed into this bus at 1, 2, 4 or 8 times the sample rate, decimated back down.")
+        .def("get_oversampling", &Bus::get_oversampling);
 
     py::class_<AudioEngine>(m, "AudioEngine")
-        .def(py::init<int, int>(), py::arg("device_index"), py::arg("num_channels"))
-        .def("get_or_create_synth", &AudioEngine::get_or_create_synth, py::arg("name"), py::arg("wavetable"), "Gets or creates a synth by its unique name.")
-        .def("get_or_create_patch", &AudioEngine::get_or_create_patch, py::arg("patch_name"), py::arg("synth_name"), py::arg("channels"), "Gets or creates a patch to route a synth to channels.")
+        .def(py::init<int, int, const StreamConfig&>(), py::arg("device_index"), py::arg("num_channels"), py::arg("config") = StreamConfig())
+        .def_static("offline", &AudioEngine::offline, py::arg("sample_rate"), py::arg("num_channels"), py::arg("block_size") = 512, "Creates a headless engine that renders on demand, with no audio device.")
+        .def("render", &AudioEngine::render, py::arg("frames"), "Offline engines: renders the next frames and returns them as a (frames, channels) float32 array.")
+        .def("render_to_file", &AudioEngine::render_to_file, py::arg("path"), py::arg("frames"), py::arg("format") = "wav", "Offline engines: renders the next frames to a 32-bit float 'wav' or 'raw' file.")
+        .def("get_or_create_synth", py::overload_cast<const std::string&, const TableArray&>(&AudioEngine::get_or_create_synth), py::arg("name"), py::arg("wavetable"), "Gets or creates a synth by its unique name.")
+        .def("get_or_create_patch", &AudioEngine::get_or_create_patch, py::arg("patch_name"), py::arg("synth_name"), py::arg("channels"), py::arg("bus") = "", "Gets or creates a patch to route a synth to channels (a bus's X/Y lanes if bus is given).")
+        .def("get_or_create_bus", &AudioEngine::get_or_create_bus, py::arg("name"), py::arg("channels") = std::vector<int>{0, 1}, py::arg("parent") = "", "Gets or creates an X/Y sub-mix bus, mixed to two device channels or into a parent bus.")
+        .def("delete_bus", &AudioEngine::delete_bus, py::arg("name"), "Deletes a bus and the patches routed into it; buses that mixed into it go to their own channels.")
+        .def("list_buses", &AudioEngine::list_buses, "Lists all buses currently in use.")
+        .def("get_or_create_poly_synth", &AudioEngine::get_or_create_poly_synth, py::arg("name"), py::arg("wavetable"), py::arg("voices") = 8, "Gets or creates a polyphonic synth with a fixed pool of voices, played with note_on/note_off.")
         .def("delete_synth", &AudioEngine::delete_synth, py::arg("name"), "Schedules a named synth and its associated patches for deletion.")
         .def("delete_patch", &AudioEngine::delete_patch, py::arg("name"), "Schedules a named patch for deletion.")
+        .def("modulate", &AudioEngine::modulate, py::arg("source"), py::arg("target"), py::arg("param"), py::arg("depth"), "Adds depth times the source synth's output to a parameter of the target synth at audio rate (depth 0 removes it).")
+        .def("list_modulations", &AudioEngine::list_modulations, "Lists (source, target, param, depth) for every modulation route.")
         .def("list_synths", &AudioEngine::list_synths, "Lists all synths currently in use.")
         .def("list_patches", &AudioEngine::list_patches, "Lists all patches currently in use.")
         .def("set_master_volume", &AudioEngine::set_master_volume, py::arg("volume"), "Sets the master volume of the engine.")
         .def("get_master_volume", &AudioEngine::get_master_volume, "Gets the master volume of the engine.")
-        .def("stop_all", &AudioEngine::stop_all, "Stops all synths in the engine.");
+        .def("find_synth", &AudioEngine::find_synth, py::arg("name"), "The synth with this name, or None.")
+        .def("find_patch", &AudioEngine::find_patch, py::arg("name"), "The patch with this name, or None.")
+        .def("find_bus", &AudioEngine::find_bus, py::arg("name"), "The bus with this name, or None.")
+        .def("store_scene", &AudioEngine::store_scene, py::arg("name"), "Snapshots every synth (with its table), bus, patch and modulation route, and the master volume, as a named scene in engine memory.")
+        .def("recall_scene", &AudioEngine::recall_scene, py::arg("name"), py::arg("fade") = 0, "Replaces the whole engine state with a stored scene on a buffer boundary, or crossfades to it over `fade` frames.")
+        .def("delete_scene", &AudioEngine::delete_scene, py::arg("name"), "Forgets a stored scene.")
+        .def("list_scenes", &AudioEngine::list_scenes, "Lists the stored scenes.")
+        .def("save_scenes", &AudioEngine::save_scenes, py::arg("path"), "Writes every stored scene to a compact binary file.")
+        .def("load_scenes", &AudioEngine::load_scenes, py::arg("path"), "Adds (or replaces) the scenes in a file written by save_scenes, without recalling any, and returns their names.")
+        .def("stop_all", &AudioEngine::stop_all, "Stops all synths in the engine.")
+        .def("open_midi_input", &AudioEngine::open_midi_input, py::arg("port") = 0, "Listens to a MIDI input port (see midi_input_ports) on a native thread.")
+        .def("open_osc_input", &AudioEngine::open_osc_input, py::arg("port"), py::arg("host") = "127.0.0.1", "Listens for OSC over UDP on host:port on a native thread.")
+        .def("close_input", &AudioEngine::close_input, "Closes the MIDI and OSC inputs; bindings are kept.")
+        .def_static("midi_input_ports", &AudioEngine::midi_input_ports, "Names of the MIDI input ports, empty if this build has no MIDI support.")
+        .def("bind_midi_cc", &AudioEngine::bind_midi_cc, py::arg("cc"), py::arg("synth"), py::arg("param"), py::arg("channel") = -1, py::arg("lo") = 0.0, py::arg("hi") = 1.0, "Maps a MIDI controller onto a synth Param, scaled to [lo, hi].")
+        .def("bind_midi_pitch_bend", &AudioEngine::bind_midi_pitch_bend, py::arg("synth"), py::arg("param"), py::arg("channel") = -1, py::arg("lo") = 0.0, py::arg("hi") = 1.0, "Maps MIDI pitch bend onto a synth Param, scaled to [lo, hi].")
+        .def("bind_midi_notes", &AudioEngine::bind_midi_notes, py::arg("synth"), py::arg("channel") = -1, "Plays a polyphonic synth from MIDI notes.")
+        .def("bind_osc", &AudioEngine::bind_osc, py::arg("address"), py::arg("synth"), py::arg("param"), py::arg("lo") = 0.0, py::arg("hi") = 1.0, "Maps the first argument of an OSC address onto a synth Param, as lo + (hi - lo) * x.")
+        .def("clear_input_bindings", &AudioEngine::clear_input_bindings, "Removes every MIDI and OSC binding.")
+        .def("set_input_callback", &AudioEngine::set_input_callback, py::arg("callback"), "Calls callback(kind, address, values) for unbound input: ('midi', '', bytes) or ('osc', address, args). None removes it.")
+        .def("inject_midi", &AudioEngine::inject_midi, py::arg("message"), "Handles a raw MIDI message as if it came from the input port.")
+        .def("inject_osc", &AudioEngine::inject_osc, py::arg("packet"), "Handles an OSC packet as if it came from the socket.")
+        .def("apply_batch", &AudioEngine::apply_batch, py::arg("handles"), py::arg("params"), py::arg("values"), py::arg("times") = py::none(), "Queues many parameter changes (synth handle, Param id, value, optional sample time) as one transaction.")
+        .def("get_sample_rate", &AudioEngine::get_sample_rate, "Sample rate of the stream in Hz.")
+        .def("sample_time", &AudioEngine::sample_time, "Master clock position in samples; pass sample_time() + n as `at` to schedule a change.")
+        .def("set_render_threads", &AudioEngine::set_render_threads, py::arg("num_threads"), py::arg("deadline") = 0.5, "Renders synths on a pool of worker threads (0 disables). deadline is the fraction of the buffer period workers get; past it the rest of the buffer, and the next second of buffers, render single-threaded. Jobs a worker already started are still waited for.")
+        .def("set_output_tap", &AudioEngine::set_output_tap, py::arg("name"), py::arg("seconds") = 1.0, "Publishes the final mix into a named shared-memory ring holding at least `seconds` of audio; an empty name closes it.")
+        .def("set_capture", &AudioEngine::set_capture, py::arg("seconds"), "Keeps the last `seconds` of output for read_output(); 0 turns capture off.")
+        .def("read_output", &AudioEngine::read_output, py::arg("frames"), "Returns the latest frames of output as a read-only (channels, frames) float32 view, without copying. Copy it to keep it.")
+        .def("get_output_tap", &AudioEngine::get_output_tap, "Name of the shared-memory output ring, or an empty string.")
+        .def("get_render_threads", &AudioEngine::get_render_threads, "Number of render worker threads (0 when rendering single-threaded).")
+        .def("render_deadline_misses", &AudioEngine::render_deadline_misses, "Number of buffers where the render workers missed their deadline.")
+        .def("render_cache_hits", &AudioEngine::render_cache_hits, "Number of patch mixes that reused a synth already rendered for another patch in the same block.")
+        .def("stats", &AudioEngine::stats, "Returns callback timing (histogram percentiles, worst case, overruns of the buffer period), xrun counts, PortAudio CPU load and output latency.")
+        .def("stream_info", &AudioEngine::stream_info, "Returns the sample rate, buffer size and output latency the host actually granted.")
+        .def("reset_stats", &AudioEngine::reset_stats, "Clears the callback timing histogram and xrun counters.");
 };
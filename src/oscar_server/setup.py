@@ -6,6 +6,7 @@ if not os.path.exists('build'):
 
 # setup.py
 
+import subprocess
 import sys
 from pybind11.setup_helpers import Pybind11Extension, build_ext
 from setuptools import setup
@@ -14,8 +15,39 @@ __version__ = "0.0.2"
 
 # Platform-specific linker arguments
 extra_link_args = []
+libraries = ["portaudio"]
 include_dirs = []
 library_dirs = []
+define_macros = [("VERSION_INFO", __version__)]
+
+# Debug build that counts (OSCAR_RT_ALLOC_CHECK=1) or aborts on (=abort) heap
+# allocations made on the audio thread.
+rt_alloc_check = os.environ.get("OSCAR_RT_ALLOC_CHECK")
+if rt_alloc_check:
+    define_macros.append(("OSCAR_RT_ALLOC_CHECK", None))
+    if rt_alloc_check == "abort":
+        define_macros.append(("OSCAR_RT_ALLOC_ABORT", None))
+    if sys.platform.startswith('linux'):
+        # Bind the module's own operator new/delete references to the replacements.
+        extra_link_args.append("-Wl,-Bsymbolic-functions")
+if sys.platform.startswith('linux'):
+    # shm_open for the shared-memory output tap (part of libc from glibc 2.34).
+    libraries.append("rt")
+if sys.platform == 'win32':
+    # Winsock, for the native OSC input.
+    libraries.append("ws2_32")
+# Native MIDI input through RtMidi, when pkg-config can find it (OSCAR_RTMIDI=0
+# builds without it; MIDI then only works through mido on the Python side).
+if os.environ.get("OSCAR_RTMIDI") != "0":
+    try:
+        rtmidi = subprocess.run(["pkg-config", "--cflags", "--libs", "rtmidi"], capture_output=True, text=True, check=True).stdout.split()
+    except (OSError, subprocess.CalledProcessError):
+        rtmidi = None
+    if rtmidi is not None:
+        define_macros.append(("OSCAR_RTMIDI", None))
+        include_dirs.extend(flag[2:] for flag in rtmidi if flag.startswith("-I"))
+        library_dirs.extend(flag[2:] for flag in rtmidi if flag.startswith("-L"))
+        libraries.extend(flag[2:] for flag in rtmidi if flag.startswith("-l"))
 if sys.platform == 'darwin':
     # On macOS, PortAudio might depend on CoreAudio services
     extra_link_args.extend([
@@ -32,8 +64,8 @@ ext_modules = [
         ["main.cpp"],
         include_dirs=include_dirs,
         library_dirs=library_dirs,
-        libraries=["portaudio"],
-        define_macros=[("VERSION_INFO", __version__)],
+        libraries=libraries,
+        define_macros=define_macros,
         extra_link_args=extra_link_args,
         cxx_std=17
     ),
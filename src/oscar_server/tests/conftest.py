@@ -0,0 +1,33 @@
+# Shared fixtures for the engine tests. Everything runs on offline engines,
+# so no audio device is needed.
+
+import numpy as np
+import pytest
+
+import oscar_server
+
+SAMPLE_RATE = 48000
+CHANNELS = 2
+
+
+def sine(size=2048):
+    return np.sin(np.linspace(0, 2 * np.pi, size, endpoint=False)).astype(np.float32)
+
+
+def saw(size=2048):
+    return np.linspace(-1, 1, size, endpoint=False).astype(np.float32)
+
+
+@pytest.fixture
+def engine():
+    return oscar_server.AudioEngine.offline(SAMPLE_RATE, CHANNELS)
+
+
+def play(engine, name, table, frequency, amplitude, channels=(0,), bus=''):
+    """Creates a running synth patched to `channels` (or a bus's lanes)."""
+    synth = engine.get_or_create_synth(name, table)
+    synth.set_frequency(frequency)
+    synth.set_amplitude(amplitude)
+    synth.start()
+    engine.get_or_create_patch('p_' + name, name, list(channels), bus)
+    return synth
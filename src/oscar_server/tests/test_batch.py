@@ -0,0 +1,74 @@
+import numpy as np
+import pytest
+
+import oscar_server
+from conftest import SAMPLE_RATE, play, sine
+
+Param = oscar_server.Param
+
+
+def batch(engine, rows, times=None):
+    handles = np.array([r[0] for r in rows], dtype=np.uint32)
+    params = np.array([int(r[1]) for r in rows], dtype=np.int32)
+    values = np.array([r[2] for r in rows], dtype=np.float64)
+    engine.apply_batch(handles, params, values, times)
+
+
+def test_batch_lands_on_next_block(engine):
+    s1 = play(engine, 's1', sine(), 440.0, 0.5)
+    s2 = play(engine, 's2', sine(), 220.0, 0.5)
+    engine.render(512)
+    batch(engine, [(s1.handle(), Param.frequency, 880.0), (s2.handle(), Param.amplitude, 0.25)])
+    engine.render(512)
+    assert s1.get_frequency() == 880.0
+    assert s2.get_amplitude() == 0.25
+
+
+def test_batch_at_sample_time(engine):
+    s1 = play(engine, 's1', sine(), 440.0, 0.5)
+    engine.render(512)
+    at = engine.sample_time() + 1000
+    batch(engine, [(s1.handle(), Param.amplitude, 0.0)], np.array([at], dtype=np.uint64))
+    out = engine.render(2000)
+    assert np.abs(out[:999, 0]).max() > 0.4
+    assert not out[1000:, 0].any()
+
+
+@pytest.mark.parametrize('param', [-1, int(Param.position) + 1, 1000])
+def test_batch_rejects_unknown_param(engine, param):
+    s1 = play(engine, 's1', sine(), 440.0, 0.5)
+    with pytest.raises(RuntimeError, match='unknown param id'):
+        engine.apply_batch(np.array([s1.handle()], dtype=np.uint32), np.array([param], dtype=np.int32),
+                           np.array([1.0]), None)
+
+
+def test_batch_rejects_bad_handle(engine):
+    s1 = play(engine, 's1', sine(), 440.0, 0.5)
+    with pytest.raises(RuntimeError, match='no synth with handle'):
+        batch(engine, [(s1.handle() + 100, Param.frequency, 880.0)])
+
+
+def test_batch_rejects_deleted_synth(engine):
+    s1 = play(engine, 's1', sine(), 440.0, 0.5)
+    handle = s1.handle()
+    engine.delete_synth('s1')
+    engine.render(512)
+    with pytest.raises(RuntimeError, match='no synth with handle'):
+        batch(engine, [(handle, Param.frequency, 880.0)])
+
+
+def test_batch_rejects_mismatched_lengths(engine):
+    s1 = play(engine, 's1', sine(), 440.0, 0.5)
+    with pytest.raises(RuntimeError, match='same length'):
+        engine.apply_batch(np.array([s1.handle()], dtype=np.uint32), np.array([int(Param.frequency)] * 2, dtype=np.int32),
+                           np.array([1.0]), None)
+
+
+def test_rejected_batch_applies_nothing(engine):
+    s1 = play(engine, 's1', sine(), 440.0, 0.5)
+    engine.render(512)
+    with pytest.raises(RuntimeError):
+        batch(engine, [(s1.handle(), Param.frequency, 880.0), (s1.handle() + 100, Param.frequency, 880.0)])
+    engine.render(512)
+    assert s1.get_frequency() == 440.0
+    assert engine.render(SAMPLE_RATE // 10).any()
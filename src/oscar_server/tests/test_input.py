@@ -0,0 +1,176 @@
+import struct
+import time
+
+import pytest
+
+import oscar_server
+from conftest import play, sine
+
+Param = oscar_server.Param
+
+
+def osc_string(s):
+    data = s.encode() + b'\0'
+    return data + b'\0' * (-len(data) % 4)
+
+
+def osc_message(address, *args):
+    tags = ','
+    payload = b''
+    for arg in args:
+        if isinstance(arg, float):
+            tags += 'f'
+            payload += struct.pack('>f', arg)
+        elif isinstance(arg, int):
+            tags += 'i'
+            payload += struct.pack('>i', arg)
+        else:
+            tags += 's'
+            payload += osc_string(arg)
+    return osc_string(address) + osc_string(tags) + payload
+
+
+def osc_bundle(*messages):
+    return b'#bundle\0' + struct.pack('>Q', 1) + b''.join(struct.pack('>I', len(m)) + m for m in messages)
+
+
+@pytest.fixture
+def s1(engine):
+    return play(engine, 's1', sine(), 440.0, 0.5)
+
+
+@pytest.fixture
+def unbound(engine):
+    received = []
+    engine.set_input_callback(lambda kind, address, values: received.append((kind, address, list(values))))
+    yield received
+    engine.set_input_callback(None)
+
+
+def test_cc_scales_onto_range(engine, s1):
+    engine.bind_midi_cc(7, 's1', Param.frequency, -1, 100.0, 1100.0)
+    engine.inject_midi([0xB0, 7, 127])
+    engine.render(512)
+    assert s1.get_frequency() == 1100.0
+    engine.inject_midi([0xB3, 7, 0])  # any channel
+    engine.render(512)
+    assert s1.get_frequency() == 100.0
+
+
+def test_cc_channel_filter(engine, s1, unbound):
+    engine.bind_midi_cc(7, 's1', Param.amplitude, 2)
+    engine.inject_midi([0xB0, 7, 0])  # channel 0: not bound
+    engine.render(512)
+    assert s1.get_amplitude() == 0.5
+    assert unbound == [('midi', '', [0xB0, 7, 0])]
+    engine.inject_midi([0xB2, 7, 0])
+    engine.render(512)
+    assert s1.get_amplitude() == 0.0
+
+
+def test_pitch_bend(engine, s1):
+    engine.bind_midi_pitch_bend('s1', Param.phase_offset, -1, 0.0, 0.5)
+    engine.inject_midi([0xE0, 0x7F, 0x7F])
+    engine.render(512)
+    assert s1.get_phase_offset() == pytest.approx(0.5)
+
+
+def test_notes_play_poly_synth(engine):
+    keys = engine.get_or_create_poly_synth('keys', sine(), 4)
+    keys.set_envelope(0.0, 0.0, 1.0, 0.0)
+    keys.start()
+    engine.get_or_create_patch('p_keys', 'keys', [0])
+    engine.bind_midi_notes('keys')
+    engine.inject_midi([0x90, 60, 100])
+    engine.inject_midi([0x90, 64, 100])
+    engine.render(512)
+    assert keys.get_active_voices() == 2
+    engine.inject_midi([0x80, 60, 0])
+    engine.inject_midi([0x90, 64, 0])  # note-on at velocity 0 is a note-off
+    engine.render(512)
+    assert keys.get_active_voices() == 0
+
+
+def test_osc_scales_first_argument(engine, s1):
+    engine.bind_osc('/s1/amp', 's1', Param.amplitude, 0.0, 0.5)
+    engine.inject_osc(osc_message('/s1/amp', 0.5, 'ignored'))
+    engine.render(512)
+    assert s1.get_amplitude() == 0.25
+    engine.inject_osc(osc_message('/s1/amp', 1))
+    engine.render(512)
+    assert s1.get_amplitude() == 0.5
+
+
+def test_osc_bundle(engine, s1):
+    engine.bind_osc('/s1/amp', 's1', Param.amplitude)
+    engine.bind_osc('/s1/freq', 's1', Param.frequency, 0.0, 1000.0)
+    engine.inject_osc(osc_bundle(osc_message('/s1/amp', 0.25), osc_message('/s1/freq', 0.5)))
+    engine.render(512)
+    assert s1.get_amplitude() == 0.25
+    assert s1.get_frequency() == 500.0
+
+
+def test_unbound_osc_reaches_callback(engine, s1, unbound):
+    engine.bind_osc('/s1/amp', 's1', Param.amplitude)
+    engine.inject_osc(osc_message('/other', 3, 0.5, 'text'))
+    engine.inject_osc(osc_message('/s1/amp'))  # bound, but nothing to map
+    assert unbound == [('osc', '/other', [3, 0.5, 'text']), ('osc', '/s1/amp', [])]
+    engine.render(512)
+    assert s1.get_amplitude() == 0.5
+
+
+@pytest.mark.parametrize('packet', [
+    b'',
+    b'/s1/amp',                                 # unterminated address
+    osc_string('/s1/amp') + osc_string(',f'),   # missing argument
+    osc_message('/s1/amp', 0.25)[:-2],          # truncated argument
+    b'#bundle\0' + struct.pack('>QI', 1, 1000),  # element longer than the packet
+    b'\xff' * 64,
+])
+def test_malformed_osc_is_ignored(engine, s1, packet):
+    engine.bind_osc('/s1/amp', 's1', Param.amplitude)
+    engine.inject_osc(packet)
+    engine.render(512)
+    assert s1.get_amplitude() == 0.5
+
+
+def test_bindings_follow_the_synth_not_the_name(engine, s1):
+    engine.bind_midi_cc(7, 's1', Param.amplitude)
+    engine.delete_synth('s1')
+    engine.render(512)
+    s1b = play(engine, 's1', sine(), 440.0, 0.5)
+    engine.inject_midi([0xB0, 7, 0])
+    engine.render(512)
+    assert s1b.get_amplitude() == 0.5
+
+
+def test_overflowing_input_is_dropped(engine, s1):
+    engine.bind_midi_cc(7, 's1', Param.amplitude)
+    start = time.monotonic()
+    for _ in range(5000):  # more than the command queue holds
+        engine.inject_midi([0xB0, 7, 0])
+    assert time.monotonic() - start < 1.0  # never waits for the queue to drain
+    engine.render(512)
+    assert s1.get_amplitude() == 0.0
+    engine.inject_midi([0xB0, 7, 127])
+    engine.render(512)
+    assert s1.get_amplitude() == 1.0
+
+
+def test_clear_bindings(engine, s1):
+    engine.bind_midi_cc(7, 's1', Param.amplitude)
+    engine.clear_input_bindings()
+    engine.inject_midi([0xB0, 7, 0])
+    engine.render(512)
+    assert s1.get_amplitude() == 0.5
+
+
+def test_bind_errors(engine, s1):
+    with pytest.raises(RuntimeError, match='start with'):
+        engine.bind_osc('s1/amp', 's1', Param.amplitude)
+    with pytest.raises(RuntimeError, match='No synth named'):
+        engine.bind_midi_cc(7, 'missing', Param.amplitude)
+    with pytest.raises(RuntimeError, match='MIDI channels'):
+        engine.bind_midi_cc(7, 's1', Param.amplitude, 16)
+    with pytest.raises(RuntimeError, match='not polyphonic'):
+        engine.bind_midi_notes('s1')
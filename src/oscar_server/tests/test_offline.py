@@ -0,0 +1,123 @@
+import struct
+import threading
+
+import numpy as np
+import pytest
+
+import oscar_server
+from conftest import CHANNELS, SAMPLE_RATE, play, sine
+
+
+def test_render_shape(engine):
+    out = engine.render(1000)
+    assert out.shape == (1000, CHANNELS)
+    assert out.dtype == np.float32
+    assert not out.any()
+
+
+def test_sine_frequency_and_amplitude(engine):
+    play(engine, 's1', sine(), 1000.0, 0.5)
+    engine.render(4800)  # let the start land
+    out = engine.render(SAMPLE_RATE)
+    # One second of audio, so FFT bins are 1 Hz apart.
+    spectrum = np.abs(np.fft.rfft(out[:, 0]))
+    assert np.argmax(spectrum) == 1000
+    assert np.max(np.abs(out[:, 0])) == pytest.approx(0.5, abs=1e-3)
+    assert np.sqrt(np.mean(out[:, 0] ** 2)) == pytest.approx(0.5 / np.sqrt(2), rel=1e-3)
+    assert not out[:, 1].any()
+
+
+def test_master_volume_scales_output(engine):
+    play(engine, 's1', sine(), 440.0, 0.5)
+    engine.set_master_volume(0.5)
+    engine.render(4800)
+    out = engine.render(SAMPLE_RATE)
+    assert np.max(np.abs(out[:, 0])) == pytest.approx(0.25, abs=1e-3)
+
+
+def test_render_is_deterministic():
+    outputs = []
+    for _ in range(2):
+        e = oscar_server.AudioEngine.offline(SAMPLE_RATE, CHANNELS)
+        play(e, 's1', sine(), 330.0, 0.4, channels=(0, 1))
+        outputs.append(e.render(10000))
+    np.testing.assert_array_equal(outputs[0], outputs[1])
+
+
+def test_synth_created_during_render(engine):
+    # A render keeps the graph it started with, so setters for a synth created
+    # while it runs must wait for the next block that has the synth.
+    for i in range(16):
+        play(engine, f'bg{i}', sine(), 100.0 + i, 0.01)
+    frames = SAMPLE_RATE * 20
+    worker = threading.Thread(target=engine.render, args=(frames,))
+    worker.start()
+    while engine.sample_time() == 0:
+        pass
+    late = play(engine, 'late', sine(), 880.0, 0.5, channels=(1,))
+    in_flight = engine.sample_time() < frames
+    worker.join()
+    assert in_flight  # otherwise the render was too short to race
+    engine.render(512)
+    assert late.is_playing()
+    assert late.get_frequency() == 880.0
+    assert late.get_amplitude() == 0.5
+
+
+def test_setters_beyond_the_queue_between_renders(engine):
+    s1 = play(engine, 's1', sine(), 440.0, 0.5)
+    for i in range(10000):  # more than the command queue holds
+        s1.set_frequency(100.0 + i)
+    engine.render(512)
+    assert s1.get_frequency() == 10099.0
+
+
+def test_queue_full_of_scheduled_changes(engine):
+    s1 = play(engine, 's1', sine(), 440.0, 0.5)
+    at = engine.sample_time() + SAMPLE_RATE
+    with pytest.raises(RuntimeError, match='scheduled ahead'):
+        for _ in range(10000):
+            s1.set_amplitude(0.25, at)
+
+
+def read_wav(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    assert data[0:4] == b'RIFF' and data[8:12] == b'WAVE'
+    assert struct.unpack_from('<I', data, 4)[0] == len(data) - 8
+    chunks = {}
+    pos = 12
+    while pos + 8 <= len(data):
+        tag, size = struct.unpack_from('<4sI', data, pos)
+        chunks[tag] = data[pos + 8:pos + 8 + size]
+        pos += 8 + size
+    return chunks
+
+
+def test_render_to_wav(engine, tmp_path):
+    play(engine, 's1', sine(), 1000.0, 0.5)
+    path = tmp_path / 'out.wav'
+    frames = 12345  # not a multiple of the block size
+    engine.render_to_file(str(path), frames)
+    chunks = read_wav(path)
+    fmt, channels, rate, byte_rate, align, bits = struct.unpack('<HHIIHH', chunks[b'fmt '])
+    assert (fmt, channels, rate, bits) == (3, CHANNELS, SAMPLE_RATE, 32)  # IEEE float
+    assert byte_rate == SAMPLE_RATE * CHANNELS * 4 and align == CHANNELS * 4
+    assert len(chunks[b'data']) == frames * CHANNELS * 4
+    samples = np.frombuffer(chunks[b'data'], dtype='<f4').reshape(frames, CHANNELS)
+    assert np.max(np.abs(samples[:, 0])) == pytest.approx(0.5, abs=1e-3)
+
+
+def test_render_to_file_matches_render(tmp_path):
+    engines = [oscar_server.AudioEngine.offline(SAMPLE_RATE, CHANNELS) for _ in range(2)]
+    for e in engines:
+        play(e, 's1', sine(), 220.0, 0.3, channels=(0, 1))
+    path = tmp_path / 'out.raw'
+    engines[0].render_to_file(str(path), 5000, 'raw')
+    raw = np.fromfile(path, dtype='<f4').reshape(-1, CHANNELS)
+    np.testing.assert_array_equal(raw, engines[1].render(5000))
+
+
+def test_render_to_file_rejects_unknown_format(engine, tmp_path):
+    with pytest.raises(RuntimeError, match='Unsupported output format'):
+        engine.render_to_file(str(tmp_path / 'out.flac'), 100, 'flac')
@@ -0,0 +1,55 @@
+import numpy as np
+import pytest
+
+import oscar_server
+from conftest import CHANNELS, SAMPLE_RATE, play, saw, sine
+
+
+def render_through_bus(factor, table, frequency, band_limited=True, nested=False):
+    e = oscar_server.AudioEngine.offline(SAMPLE_RATE, CHANNELS)
+    bus = e.get_or_create_bus('b', [0, 1])
+    bus.set_oversampling(factor)
+    target = 'b'
+    if nested:  # the factor is inherited from the parent bus
+        e.get_or_create_bus('inner', [0, 1], 'b')
+        target = 'inner'
+    synth = play(e, 's1', table, frequency, 0.5, bus=target)
+    synth.set_band_limited(band_limited)
+    e.render(4800)  # past the decimator's start-up
+    return e.render(SAMPLE_RATE)[:, 0]
+
+
+def alias_ratio_db(x, fundamental):
+    """Power outside the harmonics of `fundamental`, relative to the total."""
+    spectrum = np.abs(np.fft.rfft(x)) ** 2
+    harmonics = spectrum[fundamental::fundamental].sum()
+    return 10 * np.log10(1 - harmonics / spectrum.sum())
+
+
+@pytest.mark.parametrize('factor', [1, 2, 4, 8])
+def test_passband_is_flat(factor):
+    x = render_through_bus(factor, sine(), 1000.0)
+    assert np.sqrt(np.mean(x ** 2)) == pytest.approx(0.5 / np.sqrt(2), rel=1e-3)
+    assert np.argmax(np.abs(np.fft.rfft(x))) == 1000
+
+
+def test_oversampling_reduces_aliasing():
+    # A naive saw aliases heavily; every doubling should push the folded
+    # partials further down.
+    ratios = [alias_ratio_db(render_through_bus(f, saw(), 4100.0, band_limited=False), 4100) for f in (1, 2, 4, 8)]
+    assert all(b < a - 2.0 for a, b in zip(ratios, ratios[1:]))
+    assert ratios[-1] < ratios[0] - 10.0
+
+
+def test_child_bus_inherits_factor():
+    direct = render_through_bus(8, saw(), 4100.0, band_limited=False)
+    nested = render_through_bus(8, saw(), 4100.0, band_limited=False, nested=True)
+    np.testing.assert_allclose(nested, direct, atol=1e-6)
+
+
+@pytest.mark.parametrize('factor', [0, 3, 16])
+def test_rejects_bad_factor(engine, factor):
+    bus = engine.get_or_create_bus('b', [0, 1])
+    with pytest.raises(RuntimeError, match='must be 1, 2, 4 or 8'):
+        bus.set_oversampling(factor)
+    assert bus.get_oversampling() == 1
@@ -0,0 +1,74 @@
+import numpy as np
+import pytest
+
+from conftest import SAMPLE_RATE, sine
+
+
+def poly(engine, voices, release=0.0):
+    synth = engine.get_or_create_poly_synth('keys', sine(), voices)
+    synth.set_frequency(440.0)
+    synth.set_amplitude(0.25)
+    synth.set_envelope(0.0, 0.0, 1.0, release)
+    synth.start()
+    engine.get_or_create_patch('p_keys', 'keys', [0])
+    return synth
+
+
+def level_at(out, hz):
+    """Magnitude of the component at `hz` in one second of channel 0."""
+    spectrum = np.abs(np.fft.rfft(out[:SAMPLE_RATE, 0])) / (SAMPLE_RATE / 2)
+    return spectrum[int(hz)]
+
+
+def test_voice_pool_is_capped(engine):
+    keys = poly(engine, 2)
+    for note in (57, 69, 81):
+        keys.note_on(note)
+    engine.render(512)
+    assert keys.get_polyphony() == 2
+    assert keys.get_active_voices() == 2
+
+
+def test_same_note_retriggers(engine):
+    keys = poly(engine, 4)
+    keys.note_on(69)
+    keys.note_on(69)
+    engine.render(512)
+    assert keys.get_active_voices() == 1
+
+
+def test_steals_oldest_voice(engine):
+    keys = poly(engine, 2)
+    for note in (57, 69, 81):  # 220, 440, 880 Hz
+        keys.note_on(note)
+        engine.render(512)
+    out = engine.render(SAMPLE_RATE)
+    assert level_at(out, 220) < 1e-3
+    assert level_at(out, 440) == pytest.approx(0.25, abs=1e-2)
+    assert level_at(out, 880) == pytest.approx(0.25, abs=1e-2)
+
+
+def test_steals_released_voice_first(engine):
+    keys = poly(engine, 2, release=10.0)
+    keys.note_on(57)
+    engine.render(512)
+    keys.note_on(69)
+    engine.render(512)
+    keys.note_off(69)  # still sounding, but releasing
+    engine.render(512)
+    keys.note_on(81)
+    out = engine.render(SAMPLE_RATE)
+    assert level_at(out, 220) == pytest.approx(0.25, abs=1e-2)
+    assert level_at(out, 440) < 1e-3
+
+
+def test_released_voices_go_idle(engine):
+    keys = poly(engine, 4, release=0.01)
+    keys.note_on(60)
+    keys.note_on(64)
+    engine.render(512)
+    assert keys.get_active_voices() == 2
+    keys.all_notes_off()
+    engine.render(SAMPLE_RATE // 10)
+    assert keys.get_active_voices() == 0
+    assert not engine.render(512).any()
@@ -0,0 +1,184 @@
+import numpy as np
+import pytest
+
+import oscar_server
+from conftest import CHANNELS, SAMPLE_RATE, play, saw, sine
+
+ModParam = oscar_server.ModParam
+
+
+def new_engine():
+    return oscar_server.AudioEngine.offline(SAMPLE_RATE, CHANNELS)
+
+
+def clear(e):
+    for name in e.list_synths():
+        e.delete_synth(name)
+    for name in e.list_buses():
+        e.delete_bus(name)
+
+
+def build_figure(e):
+    """A bit of everything a scene holds."""
+    fig = e.get_or_create_bus('fig', [0, 1])
+    fig.set_gain(0.8)
+    fig.set_matrix(0.7, -0.7, 0.7, 0.7)
+    fig.set_translate(0.1, 0.0)
+    fig.set_oversampling(2)
+    play(e, 'x', sine(), 220.0, 0.5, channels=(0,), bus='fig')
+    play(e, 'y', sine(), 220.0, 0.5, channels=(1,), bus='fig').set_phase_offset(0.25)
+    play(e, 'lfo', saw(256), 2.0, 1.0, channels=())
+    keys = e.get_or_create_poly_synth('keys', saw(1024), 4)
+    keys.set_envelope(0.01, 0.1, 0.7, 0.3)
+    keys.set_interpolation(oscar_server.Interpolation.hermite)
+    keys.start()
+    e.get_or_create_patch('pk', 'keys', [0, 1])
+    e.modulate('lfo', 'x', ModParam.amplitude, 0.2)
+    e.set_master_volume(0.8)
+
+
+def build_drone(e):
+    play(e, 'x', saw(), 110.0, 0.4, channels=(0, 1))
+    e.set_master_volume(0.5)
+
+
+def two_scenes(e):
+    """Stores the figure as 'a' and the drone as 'b', leaving `e` on 'a'."""
+    build_figure(e)
+    e.store_scene('a')
+    clear(e)
+    build_drone(e)
+    e.store_scene('b')
+    e.recall_scene('a')
+
+
+def test_save_load_store_round_trip(tmp_path):
+    e1 = new_engine()
+    build_figure(e1)
+    e1.store_scene('a')  # settles the setters still queued
+    e1.save_scenes(str(tmp_path / 'f1.oscs'))
+
+    e2 = new_engine()
+    assert e2.load_scenes(str(tmp_path / 'f1.oscs')) == ['a']
+    e2.save_scenes(str(tmp_path / 'f2.oscs'))
+    e2.recall_scene('a')
+    e2.store_scene('a')
+    e2.save_scenes(str(tmp_path / 'f3.oscs'))
+
+    original = (tmp_path / 'f1.oscs').read_bytes()
+    assert (tmp_path / 'f2.oscs').read_bytes() == original
+    assert (tmp_path / 'f3.oscs').read_bytes() == original
+
+
+def test_loaded_scene_renders_like_the_original(tmp_path):
+    e1 = new_engine()
+    build_figure(e1)
+    e1.store_scene('a')
+    e1.save_scenes(str(tmp_path / 'f.oscs'))
+
+    built = new_engine()
+    build_figure(built)
+    loaded = new_engine()
+    loaded.load_scenes(str(tmp_path / 'f.oscs'))
+    loaded.recall_scene('a')
+    for e in (built, loaded):
+        e.find_synth('keys').note_on(60)
+    assert sorted(loaded.list_synths()) == ['keys', 'lfo', 'x', 'y']
+    assert loaded.list_modulations() == built.list_modulations()
+    assert loaded.get_master_volume() == pytest.approx(0.8)
+    out = built.render(20000)
+    assert np.abs(out).max() > 0.1
+    np.testing.assert_array_equal(loaded.render(20000), out)
+
+
+def test_recall_replaces_everything(engine):
+    two_scenes(engine)
+    x = engine.find_synth('x')
+    engine.recall_scene('b')
+    assert engine.list_synths() == ['x']
+    assert engine.list_buses() == []
+    assert engine.find_synth('y') is None
+    assert engine.find_bus('fig') is None
+    assert engine.get_master_volume() == pytest.approx(0.5)
+    # Same name, same handle, so bindings and apply_batch handles carry over.
+    assert engine.find_synth('x').handle() == x.handle()
+    assert engine.find_synth('x').get_frequency() == 110.0
+
+
+def test_hard_recall_matches_a_fresh_build(engine):
+    two_scenes(engine)
+    engine.recall_scene('b')
+    reference = new_engine()
+    build_drone(reference)
+    np.testing.assert_array_equal(engine.render(5000), reference.render(5000))
+
+
+def test_crossfade(engine, tmp_path):
+    fade = 1500
+    two_scenes(engine)
+    engine.save_scenes(str(tmp_path / 'f.oscs'))
+    # Engines at the same clock: one crossfades, one cuts to 'b', one stays on 'a'.
+    cut, stay = new_engine(), new_engine()
+    for e in (cut, stay):
+        e.load_scenes(str(tmp_path / 'f.oscs'))
+        e.recall_scene('a')
+    for e in (engine, cut, stay):
+        e.render(1000)
+    engine.recall_scene('b', fade)
+    cut.recall_scene('b')
+    out = engine.render(fade + 1000)
+    old = stay.render(fade + 1000)
+    new = cut.render(fade + 1000)
+    g = (np.arange(fade) / fade)[:, None]
+    np.testing.assert_allclose(out[:fade], (1 - g) * old[:fade] + g * new[:fade], atol=1e-4)
+    np.testing.assert_array_equal(out[fade:], new[fade:])
+
+
+def test_scene_list_and_errors(engine, tmp_path):
+    two_scenes(engine)
+    assert engine.list_scenes() == ['a', 'b']
+    engine.delete_scene('a')
+    assert engine.list_scenes() == ['b']
+    with pytest.raises(RuntimeError, match="'a' does not exist"):
+        engine.recall_scene('a')
+    with pytest.raises(RuntimeError, match='Cannot open'):
+        engine.load_scenes(str(tmp_path / 'missing.oscs'))
+
+
+def test_damaged_files_are_rejected(engine, tmp_path):
+    two_scenes(engine)
+    path = tmp_path / 'f.oscs'
+    engine.save_scenes(str(path))
+    data = path.read_bytes()
+
+    other = new_engine()
+    build_drone(other)
+    other.store_scene('mine')
+    (tmp_path / 'junk').write_bytes(b'RIFF' + data[4:])
+    with pytest.raises(RuntimeError, match='Not a scene file'):
+        other.load_scenes(str(tmp_path / 'junk'))
+    for cut in (8, len(data) // 2, len(data) - 1):
+        (tmp_path / 'short').write_bytes(data[:cut])
+        with pytest.raises(RuntimeError, match='truncated|corrupt'):
+            other.load_scenes(str(tmp_path / 'short'))
+    # A failed load keeps none of the file's scenes.
+    assert other.list_scenes() == ['mine']
+
+
+def test_damaged_files_never_crash(engine, tmp_path):
+    two_scenes(engine)
+    path = tmp_path / 'f.oscs'
+    engine.save_scenes(str(path))
+    data = bytearray(path.read_bytes())
+    rng = np.random.default_rng(1)
+    for _ in range(200):
+        damaged = bytearray(data)
+        damaged[rng.integers(len(damaged))] ^= 1 << int(rng.integers(8))
+        path.write_bytes(bytes(damaged))
+        e = new_engine()
+        try:
+            for name in e.load_scenes(str(path)):
+                e.recall_scene(name)
+                e.render(512)
+        except RuntimeError:
+            pass